@@ -16,19 +16,26 @@
 
 #include <memory>
 #include <iostream>
-#include <queue>
+#include <vector>
 #include <util.h>
 
 namespace tinyrv {
 
+// Pipeline FIFO register over a fixed-capacity ring.
+// Pushes and pops take effect at the next tick, several of each may be
+// issued in the same cycle. data() returns the oldest entry not popped yet,
+// and a full FIFO accepts as many pushes as it has pending pops.
 template <typename T>
 class FiFoReg : public SimObject<FiFoReg<T>> {
 public:
   FiFoReg(const SimContext& ctx, const char* name, uint32_t depth = 1)
     : SimObject<FiFoReg<T>>(ctx, name)
+    , buffer_(depth)
     , depth_(depth)
-    , push_pending_(false)
-    , pop_pending_(false)
+    , head_(0)
+    , size_(0)
+    , pushes_(0)
+    , pops_(0)
   {
     assert(depth > 0);
   }
@@ -36,54 +43,60 @@ public:
   ~FiFoReg() {}
 
   bool empty() const {
-    return (buffer_.empty() && !push_pending_)
-        || (buffer_.size() == 1 && pop_pending_);
+    return size_ == pops_;
   }
 
   bool full() const {
-    return (buffer_.size() == depth_ && !pop_pending_)
-        || (buffer_.size() == (depth_-1) && push_pending_);
+    return (size_ - pops_ + pushes_) >= depth_;
+  }
+
+  // entries available to pop this cycle
+  uint32_t size() const {
+    return size_ - pops_;
+  }
+
+  uint32_t depth() const {
+    return depth_;
   }
 
   const T& data() const {
-    assert(!buffer_.empty());
-    return buffer_.front();
+    assert(!this->empty());
+    return buffer_[(head_ + pops_) % depth_];
   }
 
   void push(const T& data) {
     assert(!full());
-    push_pending_ = true;
-    push_data_ = data;
+    // slots popped this cycle are free to reuse
+    buffer_[(head_ + size_ + pushes_) % depth_] = data;
+    ++pushes_;
   }
 
   void pop() {
     assert(!empty());
-    pop_pending_ = true;
+    ++pops_;
   }
 
   void reset() {
-    buffer_ = std::queue<T>();
-    push_pending_ = false;
-    pop_pending_ = false;
+    head_ = 0;
+    size_ = 0;
+    pushes_ = 0;
+    pops_ = 0;
   }
 
   void tick() {
-    if (pop_pending_ && !buffer_.empty()) {
-      buffer_.pop();
-      pop_pending_ = false;
-    }
-    if (push_pending_ && buffer_.size() < depth_) {
-      buffer_.push(push_data_);
-      push_pending_ = false;
-    }
+    head_ = (head_ + pops_) % depth_;
+    size_ = size_ - pops_ + pushes_;
+    pushes_ = 0;
+    pops_ = 0;
   }
 
 protected:
+  std::vector<T> buffer_;
   uint32_t depth_;
-  std::queue<T> buffer_;
-  bool push_pending_;
-  bool pop_pending_;
-  T push_data_;
+  uint32_t head_;
+  uint32_t size_;
+  uint32_t pushes_;
+  uint32_t pops_;
 };
 
 }
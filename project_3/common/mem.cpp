@@ -13,10 +13,22 @@
 
 #include "mem.h"
 #include <vector>
+#include <string>
 #include <iostream>
 #include <fstream>
+#include <algorithm>
+#include <string.h>
 #include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include <elf.h>
 #include "util.h"
+#include "symtab.h"
 
 using namespace tinyrv;
 
@@ -121,12 +133,83 @@ void MemoryUnit::ADecoder::write(const void* data, uint64_t addr, uint64_t size)
 
 ///////////////////////////////////////////////////////////////////////////////
 
-MemoryUnit::MemoryUnit(uint64_t pageSize)
-  : pageSize_(pageSize)
+MemoryUnit::TLB::TLB(uint32_t sets, uint32_t ways)
+  : ways_(sets * ways)
+  , num_sets_(sets)
+  , num_ways_(ways)
+  , clock_(0) {
+  assert(ispow2(sets) && ways != 0);
+  this->flush(false, 0, false, 0);
+}
+
+const MemoryUnit::TLBEntry* MemoryUnit::TLB::lookup(uint64_t vpn, uint32_t asid) {
+  auto set = ways_.data() + (vpn & (num_sets_ - 1)) * num_ways_;
+  for (uint32_t w = 0; w < num_ways_; ++w) {
+    auto& way = set[w];
+    if (way.valid && way.vpn == vpn && (way.global || way.asid == asid)) {
+      way.stamp = ++clock_;
+      return &way.entry;
+    }
+  }
+  return nullptr;
+}
+
+void MemoryUnit::TLB::insert(uint64_t vpn, const TLBEntry& entry, uint32_t asid, bool global) {
+  auto set = ways_.data() + (vpn & (num_sets_ - 1)) * num_ways_;
+  auto victim = set;
+  for (uint32_t w = 0; w < num_ways_; ++w) {
+    auto& way = set[w];
+    if (way.valid && way.vpn == vpn && (way.global || way.asid == asid)) {
+      victim = &way;
+      break;
+    }
+    if (!way.valid) {
+      if (victim->valid) {
+        victim = &way;
+      }
+    } else if (victim->valid && way.stamp < victim->stamp) {
+      victim = &way;
+    }
+  }
+  *victim = {true, global, asid, vpn, entry, ++clock_};
+}
+
+void MemoryUnit::TLB::flush(bool use_vpn, uint64_t vpn, bool use_asid, uint32_t asid) {
+  for (auto& way : ways_) {
+    if (use_vpn && way.vpn != vpn)
+      continue;
+    // global mappings survive ASID-specific fences
+    if (use_asid && (way.global || way.asid != asid))
+      continue;
+    way.valid = false;
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+// Sv32 definitions
+static constexpr uint32_t SATP_MODE_SV32 = 0x80000000;
+static constexpr uint32_t SATP_ASID_SHIFT = 22;
+static constexpr uint32_t SATP_ASID_MASK = 0x1ff;
+static constexpr uint32_t SATP_PPN_MASK = 0x3fffff;
+static constexpr uint32_t SV32_PAGE_BITS = 12;
+static constexpr uint32_t PTE_V = 0x01;
+static constexpr uint32_t PTE_R = 0x02;
+static constexpr uint32_t PTE_W = 0x04;
+static constexpr uint32_t PTE_X = 0x08;
+static constexpr uint32_t PTE_G = 0x20;
+
+MemoryUnit::MemoryUnit(uint64_t pageSize, const TLBConfig& tlbConfig)
+  : itlb_(tlbConfig.itlb_sets, tlbConfig.itlb_ways)
+  , dtlb_(tlbConfig.dtlb_sets, tlbConfig.dtlb_ways)
+  , l2tlb_(tlbConfig.l2tlb_sets, tlbConfig.l2tlb_ways)
+  , pageSize_(pageSize)
   , enableVM_(pageSize != 0)
+  , satp_(0)
+  , xlat_({XLAT_NONE, 0, {0, 0}})
   , amo_reservation_({0x0, false}) {
   if (pageSize != 0) {
-    tlb_[0] = TLBEntry(0, 077);
+    this->tlbAdd(0, 0, 077);
   }
 }
 
@@ -135,10 +218,10 @@ void MemoryUnit::attach(MemDevice &m, uint64_t start, uint64_t end) {
 }
 
 MemoryUnit::TLBEntry MemoryUnit::tlbLookup(uint64_t vAddr, uint32_t flagMask) {
-  auto iter = tlb_.find(vAddr / pageSize_);
-  if (iter != tlb_.end()) {
-    if (iter->second.flags & flagMask)
-      return iter->second;
+  auto entry = l2tlb_.lookup(vAddr / pageSize_, 0);
+  if (entry != nullptr) {
+    if (entry->flags & flagMask)
+      return *entry;
     else {
       throw PageFault(vAddr, false);
     }
@@ -147,45 +230,123 @@ MemoryUnit::TLBEntry MemoryUnit::tlbLookup(uint64_t vAddr, uint32_t flagMask) {
   }
 }
 
-uint64_t MemoryUnit::toPhyAddr(uint64_t addr, uint32_t flagMask) {
-  uint64_t pAddr;
+MemoryUnit::TLBEntry MemoryUnit::sv32Walk(uint64_t vAddr) {
+  uint64_t vpn = vAddr >> SV32_PAGE_BITS;
+  uint64_t table = uint64_t(satp_ & SATP_PPN_MASK) << SV32_PAGE_BITS;
+  xlat_.num_ptes = 0;
+  for (int level = 1; level >= 0; --level) {
+    uint64_t pte_addr = table + ((vpn >> (10 * level)) & 0x3ff) * 4;
+    uint32_t pte = 0;
+    decoder_.read(&pte, pte_addr, 4);
+    xlat_.pte_addr[xlat_.num_ptes++] = pte_addr;
+    ++perf_stats_.pte_reads;
+    if (!(pte & PTE_V) || (!(pte & PTE_R) && (pte & PTE_W)))
+      throw PageFault(vAddr, true);
+    uint32_t ppn = pte >> 10;
+    if (pte & (PTE_R | PTE_X)) {
+      if (level == 1) {
+        // superpages are splintered into 4KB TLB entries
+        if (ppn & 0x3ff)
+          throw PageFault(vAddr, true);
+        ppn |= vpn & 0x3ff;
+      }
+      return TLBEntry(ppn, pte & 0xff);
+    }
+    table = uint64_t(ppn) << SV32_PAGE_BITS;
+  }
+  throw PageFault(vAddr, true);
+}
+
+uint64_t MemoryUnit::toPhyAddr(uint64_t addr, AccessType type, bool sup) {
+  if (satp_ & SATP_MODE_SV32) {
+    uint64_t vpn = addr >> SV32_PAGE_BITS;
+    uint32_t asid = (satp_ >> SATP_ASID_SHIFT) & SATP_ASID_MASK;
+    bool is_fetch = (type == ACCESS_FETCH);
+    auto& l1tlb = is_fetch ? itlb_ : dtlb_;
+    xlat_.num_ptes = 0;
+    auto entry = l1tlb.lookup(vpn, asid);
+    TLBEntry t;
+    if (entry) {
+      ++(is_fetch ? perf_stats_.itlb_hits : perf_stats_.dtlb_hits);
+      xlat_.level = XLAT_L1;
+      t = *entry;
+    } else {
+      ++(is_fetch ? perf_stats_.itlb_misses : perf_stats_.dtlb_misses);
+      entry = l2tlb_.lookup(vpn, asid);
+      if (entry) {
+        ++perf_stats_.l2tlb_hits;
+        xlat_.level = XLAT_L2;
+        t = *entry;
+      } else {
+        ++perf_stats_.l2tlb_misses;
+        xlat_.level = XLAT_WALK;
+        t = this->sv32Walk(addr);
+        l2tlb_.insert(vpn, t, asid, t.flags & PTE_G);
+      }
+      l1tlb.insert(vpn, t, asid, t.flags & PTE_G);
+    }
+    uint32_t perm = (type == ACCESS_FETCH) ? PTE_X : ((type == ACCESS_STORE) ? PTE_W : PTE_R);
+    if (!(t.flags & perm))
+      throw PageFault(addr, false);
+    return (uint64_t(t.pfn) << SV32_PAGE_BITS) | (addr & ((1 << SV32_PAGE_BITS) - 1));
+  }
+
+  xlat_.level = XLAT_NONE;
+  xlat_.num_ptes = 0;
   if (enableVM_) {
+    uint32_t flagMask = (type == ACCESS_STORE) ? (sup ? 16 : 1) : (sup ? 8 : 1);
     TLBEntry t = this->tlbLookup(addr, flagMask);
-    pAddr = t.pfn * pageSize_ + addr % pageSize_;
-  } else {
-    pAddr = addr;    
+    return t.pfn * pageSize_ + addr % pageSize_;
   }
-  return pAddr;
+  return addr;
 }
 
 void MemoryUnit::read(void* data, uint64_t addr, uint64_t size, bool sup) {
-  uint64_t pAddr = this->toPhyAddr(addr, sup ? 8 : 1);
+  uint64_t pAddr = this->toPhyAddr(addr, ACCESS_LOAD, sup);
   return decoder_.read(data, pAddr, size);
 }
 
 void MemoryUnit::write(const void* data, uint64_t addr, uint64_t size, bool sup) {
-  uint64_t pAddr = this->toPhyAddr(addr, sup ? 16 : 1);
+  uint64_t pAddr = this->toPhyAddr(addr, ACCESS_STORE, sup);
   decoder_.write(data, pAddr, size);
   amo_reservation_.valid = false;
 }
 
+void MemoryUnit::fetch(void* data, uint64_t addr, uint64_t size) {
+  uint64_t pAddr = this->toPhyAddr(addr, ACCESS_FETCH, false);
+  decoder_.read(data, pAddr, size);
+}
+
 void MemoryUnit::amo_reserve(uint64_t addr) {
-  uint64_t pAddr = this->toPhyAddr(addr, 1);
+  uint64_t pAddr = this->toPhyAddr(addr, ACCESS_LOAD, false);
   amo_reservation_.addr = pAddr;
   amo_reservation_.valid = true;
 }
 
 bool MemoryUnit::amo_check(uint64_t addr) {
-  uint64_t pAddr = this->toPhyAddr(addr, 1);
+  uint64_t pAddr = this->toPhyAddr(addr, ACCESS_LOAD, false);
   return amo_reservation_.valid && (amo_reservation_.addr == pAddr);
 }
+
+void MemoryUnit::set_satp(uint32_t satp) {
+  // TLB entries are tagged with their ASID, switching needs no flush
+  satp_ = satp;
+}
+
+void MemoryUnit::sfence(bool use_vaddr, uint64_t vaddr, bool use_asid, uint32_t asid) {
+  uint64_t vpn = vaddr >> SV32_PAGE_BITS;
+  asid &= SATP_ASID_MASK;
+  itlb_.flush(use_vaddr, vpn, use_asid, asid);
+  dtlb_.flush(use_vaddr, vpn, use_asid, asid);
+  l2tlb_.flush(use_vaddr, vpn, use_asid, asid);
+}
+
 void MemoryUnit::tlbAdd(uint64_t virt, uint64_t phys, uint32_t flags) {
-  tlb_[virt / pageSize_] = TLBEntry(phys / pageSize_, flags);
+  l2tlb_.insert(virt / pageSize_, TLBEntry(phys / pageSize_, flags), 0, true);
 }
 
 void MemoryUnit::tlbRm(uint64_t va) {
-  if (tlb_.find(va / pageSize_) != tlb_.end())
-    tlb_.erase(tlb_.find(va / pageSize_));
+  l2tlb_.flush(true, va / pageSize_, false, 0);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -208,6 +369,9 @@ void RAM::clear() {
   for (auto& page : pages_) {
     delete[] page.second;
   }
+  pages_.clear();
+  zero_ranges_.clear();
+  last_page_ = nullptr;
 }
 
 uint64_t RAM::size() const {
@@ -235,6 +399,15 @@ uint8_t *RAM::get(uint64_t address) const {
       for (uint32_t i = 0; i < page_size; ++i) {
         ptr[i] = (0xbaadf00d >> ((i & 0x3) * 8)) & 0xff;
       }
+      // apply pending zero-fill ranges
+      uint64_t page_start = page_index << page_bits_;
+      for (auto& range : zero_ranges_) {
+        uint64_t start = std::max<uint64_t>(range.addr, page_start);
+        uint64_t end = std::min<uint64_t>(range.addr + range.size, page_start + page_size);
+        if (start < end) {
+          memset(ptr + (start - page_start), 0, end - start);
+        }
+      }
       pages_.emplace(page_index, ptr);
       page = ptr;
     }
@@ -245,20 +418,49 @@ uint8_t *RAM::get(uint64_t address) const {
   return page + page_offset;
 }
 
+
 void RAM::read(void* data, uint64_t addr, uint64_t size) {
   uint8_t* d = (uint8_t*)data;
-  for (uint64_t i = 0; i < size; i++) {
-    d[i] = *this->get(addr + i);
+  uint32_t page_size = 1 << page_bits_;
+  while (size != 0) {
+    // copy up to the end of the current page
+    uint64_t chunk = std::min<uint64_t>(size, page_size - (addr & (page_size - 1)));
+    memcpy(d, this->get(addr), chunk);
+    d += chunk;
+    addr += chunk;
+    size -= chunk;
   }
 }
 
 void RAM::write(const void* data, uint64_t addr, uint64_t size) {
-  const uint8_t* d = (const uint8_t*)data;
-  for (uint64_t i = 0; i < size; i++) {
-    *this->get(addr + i) = d[i];
+  const uint8_t* s = (const uint8_t*)data;
+  uint32_t page_size = 1 << page_bits_;
+  while (size != 0) {
+    // copy up to the end of the current page
+    uint64_t chunk = std::min<uint64_t>(size, page_size - (addr & (page_size - 1)));
+    memcpy(this->get(addr), s, chunk);
+    s += chunk;
+    addr += chunk;
+    size -= chunk;
   }
 }
 
+void RAM::zeroFill(uint64_t addr, uint64_t size) {
+  if (size == 0)
+    return;
+  // clear the pages already allocated, the others are cleared on first touch
+  uint32_t page_size = 1 << page_bits_;
+  for (auto& page : pages_) {
+    uint64_t page_start = page.first << page_bits_;
+    uint64_t start = std::max<uint64_t>(addr, page_start);
+    uint64_t end = std::min<uint64_t>(addr + size, page_start + page_size);
+    if (start < end) {
+      memset(page.second + (start - page_start), 0, end - start);
+    }
+  }
+  zero_ranges_.push_back({addr, size});
+}
+
 void RAM::loadBinImage(const char* filename, uint64_t destination) {
   std::ifstream ifs(filename);
   if (!ifs) {
@@ -276,24 +478,88 @@ void RAM::loadBinImage(const char* filename, uint64_t destination) {
   this->write(content.data(), destination, size);
 }
 
-void RAM::loadHexImage(const char* filename) {
-  auto hti = [&](char c)->uint32_t {
-    if (c >= 'A' && c <= 'F')
-      return c - 'A' + 10;
-    if (c >= 'a' && c <= 'f')
-      return c - 'a' + 10;
-    return c - '0';
-  };
+///////////////////////////////////////////////////////////////////////////////
 
-  auto hToI = [&](const char *c, uint32_t size)->uint32_t {
-    uint32_t value = 0;
-    for (uint32_t i = 0; i < size; i++) {
-      value += hti(c[i]) << ((size - i - 1) * 4);
+// hex digit values, 0xff marks an invalid character
+struct HexTable {
+  uint8_t value[256];
+  HexTable() {
+    memset(value, 0xff, sizeof(value));
+    for (int i = 0; i < 10; ++i) {
+      value['0' + i] = i;
     }
-    return value;
-  };
+    for (int i = 0; i < 6; ++i) {
+      value['A' + i] = 10 + i;
+      value['a' + i] = 10 + i;
+    }
+  }
+};
 
-  std::ifstream ifs(filename);
+static const HexTable sc_hexTable;
+
+#ifdef __SSE2__
+
+// decode 16 hex characters into 8 bytes.
+// returns a bitmask of the invalid input characters.
+static inline uint32_t hex_decode16(uint8_t* dst, const char* src) {
+  __m128i in = _mm_loadu_si128((const __m128i*)src);
+
+  // '0'..'9'
+  __m128i dig = _mm_sub_epi8(in, _mm_set1_epi8('0'));
+  __m128i is_dig = _mm_and_si128(_mm_cmpgt_epi8(dig, _mm_set1_epi8(-1)),
+                                 _mm_cmplt_epi8(dig, _mm_set1_epi8(10)));
+  // 'A'..'F' and 'a'..'f'
+  __m128i alp = _mm_sub_epi8(_mm_or_si128(in, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+  __m128i is_alp = _mm_and_si128(_mm_cmpgt_epi8(alp, _mm_set1_epi8(-1)),
+                                 _mm_cmplt_epi8(alp, _mm_set1_epi8(6)));
+
+  uint32_t valid = _mm_movemask_epi8(_mm_or_si128(is_dig, is_alp));
+
+  __m128i nib = _mm_or_si128(_mm_and_si128(is_dig, dig),
+                             _mm_and_si128(is_alp, _mm_add_epi8(alp, _mm_set1_epi8(10))));
+
+  // merge nibble pairs: the high nibble comes first in memory
+  __m128i hi = _mm_slli_epi16(_mm_and_si128(nib, _mm_set1_epi16(0x00ff)), 4);
+  __m128i lo = _mm_srli_epi16(nib, 8);
+  __m128i bytes = _mm_packus_epi16(_mm_or_si128(hi, lo), _mm_setzero_si128());
+  _mm_storel_epi64((__m128i*)dst, bytes);
+
+  return ~valid & 0xffff;
+}
+
+#endif
+
+// decode 2*count hex characters into count bytes.
+// returns the offset of the first invalid character, or -1 on success.
+static int hex_decode(uint8_t* dst, const char* src, uint32_t count) {
+  uint32_t i = 0;
+#ifdef __SSE2__
+  for (; i + 8 <= count; i += 8) {
+    uint32_t invalid = hex_decode16(dst + i, src + 2 * i);
+    if (invalid)
+      return 2 * i + count_trailing_zeros(invalid);
+  }
+#endif
+  for (; i < count; ++i) {
+    uint8_t hi = sc_hexTable.value[(uint8_t)src[2 * i + 0]];
+    uint8_t lo = sc_hexTable.value[(uint8_t)src[2 * i + 1]];
+    if ((hi | lo) & 0xf0)
+      return 2 * i + ((hi & 0xf0) ? 0 : 1);
+    dst[i] = (hi << 4) | lo;
+  }
+  return -1;
+}
+
+[[noreturn]] static void hex_error(const char* filename, uint32_t line, uint32_t column, const char* msg) {
+  std::cout << "error: " << filename << ":" << std::dec << line << ":" << column << ": " << msg << std::endl;
+  std::abort();
+}
+
+void RAM::loadHexImage(const char* filename, bool use_cache) {
+  if (use_cache && this->loadImageCache(filename))
+    return;
+
+  std::ifstream ifs(filename, std::ios::binary);
   if (!ifs) {
     std::cout << "error: " << filename << " not found" << std::endl;
     std::abort();
@@ -305,41 +571,364 @@ void RAM::loadHexImage(const char* filename) {
   ifs.seekg(0, ifs.beg);
   ifs.read(content.data(), size);
 
+  this->clear();
+
+  // record layout: ':' count(1) address(2) type(1) data(count) checksum(1)
+  uint8_t record[5 + 255];
   uint32_t offset = 0;
-  char *line = content.data();
+  uint32_t line_no = 0;
+  bool eof = false;
+  std::vector<segment_t> segments;
+
+  const char* cur = content.data();
+  const char* end = cur + size;
+
+  while (cur < end && !eof) {
+    const char* line = cur;
+    const char* line_end = (const char*)memchr(cur, '\n', end - cur);
+    if (line_end == nullptr) {
+      line_end = end;
+    }
+    cur = line_end + 1;
+    ++line_no;
 
-  this->clear();
+    // strip the line terminator
+    while (line_end > line && (line_end[-1] == '\r' || line_end[-1] == ' ' || line_end[-1] == '\t')) {
+      --line_end;
+    }
+    if (line_end == line)
+      continue;
 
-  while (true) {
-    if (line[0] == ':') {
-      uint32_t byteCount = hToI(line + 1, 2);
-      uint32_t nextAddr = hToI(line + 3, 4) + offset;
-      uint32_t key = hToI(line + 7, 2);
-      switch (key) {
-      case 0:
-        for (uint32_t i = 0; i < byteCount; i++) {
-          uint32_t addr  = nextAddr + i;
-          uint32_t value = hToI(line + 9 + i * 2, 2);
-          *this->get(addr) = value;
-        }
-        break;
-      case 2:
-        offset = hToI(line + 9, 4) << 4;
-        break;
-      case 4:
-        offset = hToI(line + 9, 4) << 16;
-        break;
-      default:
-        break;
+    uint32_t length = line_end - line;
+    if (line[0] != ':') {
+      hex_error(filename, line_no, 1, "missing record start code");
+    }
+    if (length < 11) {
+      hex_error(filename, line_no, length + 1, "truncated record");
+    }
+
+    // decode the byte count first to size the record
+    int bad = hex_decode(record, line + 1, 1);
+    if (bad >= 0) {
+      hex_error(filename, line_no, 2 + bad, "invalid hex digit");
+    }
+    uint32_t count = record[0];
+    uint32_t record_size = 5 + count;
+    if (length != 1 + 2 * record_size) {
+      hex_error(filename, line_no, length + 1, "record length does not match its byte count");
+    }
+
+    bad = hex_decode(record, line + 1, record_size);
+    if (bad >= 0) {
+      hex_error(filename, line_no, 2 + bad, "invalid hex digit");
+    }
+
+    uint8_t checksum = 0;
+    for (uint32_t i = 0; i < record_size; ++i) {
+      checksum += record[i];
+    }
+    if (checksum != 0) {
+      hex_error(filename, line_no, length - 1, "checksum mismatch");
+    }
+
+    uint32_t address = (record[1] << 8) | record[2];
+    uint32_t type = record[3];
+    const uint8_t* data = record + 4;
+
+    switch (type) {
+    case 0: // data
+      this->write(data, offset + address, count);
+      if (!segments.empty()
+       && segments.back().addr + segments.back().size == offset + address) {
+        segments.back().size += count;
+      } else {
+        segments.push_back({offset + address, count});
+      }
+      break;
+    case 1: // end of file
+      eof = true;
+      break;
+    case 2: // extended segment address
+      if (count != 2) {
+        hex_error(filename, line_no, 2, "invalid byte count for segment address record");
+      }
+      offset = ((data[0] << 8) | data[1]) << 4;
+      break;
+    case 3: // start segment address
+    case 5: // start linear address
+      if (count != 4) {
+        hex_error(filename, line_no, 2, "invalid byte count for start address record");
       }
+      break;
+    case 4: // extended linear address
+      if (count != 2) {
+        hex_error(filename, line_no, 2, "invalid byte count for linear address record");
+      }
+      offset = ((data[0] << 8) | data[1]) << 16;
+      break;
+    default:
+      hex_error(filename, line_no, 8, "unsupported record type");
     }
-    while (*line != '\n' && size != 0) {
-      ++line;
-      --size;
+  }
+
+  if (use_cache) {
+    this->saveImageCache(filename, segments);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+// Parsed images are cached in a "<program>.imgcache" sidecar file.
+// The cache holds the image segments as (address, size, bytes) records,
+// and is keyed by the source path, size, modification time and content hash.
+
+#define IMG_CACHE_MAGIC   0x31474d4956525424ull // "$TRVIMG1"
+#define IMG_CACHE_SUFFIX  ".imgcache"
+
+struct img_cache_header_t {
+  uint64_t magic;
+  uint64_t path_hash;
+  uint64_t src_size;
+  uint64_t src_mtime;
+  uint64_t src_hash;
+  uint64_t num_segments;
+};
+
+struct img_cache_segment_t {
+  uint64_t addr;
+  uint64_t size;
+};
+
+static uint64_t fnv1a_hash(const void* data, uint64_t size, uint64_t hash = 0xcbf29ce484222325ull) {
+  // hash 8 bytes at a time, the cache only needs to detect changes
+  const uint8_t* p = (const uint8_t*)data;
+  for (; size >= 8; p += 8, size -= 8) {
+    uint64_t word;
+    memcpy(&word, p, 8);
+    hash = (hash ^ word) * 0x100000001b3ull;
+  }
+  for (; size != 0; ++p, --size) {
+    hash = (hash ^ *p) * 0x100000001b3ull;
+  }
+  return hash;
+}
+
+static bool img_cache_key(const char* filename, img_cache_header_t* header) {
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0)
+    return false;
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return false;
+  }
+  std::vector<uint8_t> content(st.st_size);
+  ssize_t bytes = read(fd, content.data(), content.size());
+  close(fd);
+  if (bytes != (ssize_t)content.size())
+    return false;
+  header->magic     = IMG_CACHE_MAGIC;
+  header->path_hash = fnv1a_hash(filename, strlen(filename));
+  header->src_size  = st.st_size;
+  header->src_mtime = uint64_t(st.st_mtim.tv_sec) * 1000000000ull + st.st_mtim.tv_nsec;
+  header->src_hash  = fnv1a_hash(content.data(), content.size());
+  header->num_segments = 0;
+  return true;
+}
+
+bool RAM::loadImageCache(const char* filename) {
+  img_cache_header_t key;
+  if (!img_cache_key(filename, &key))
+    return false;
+
+  std::string cache_path = std::string(filename) + IMG_CACHE_SUFFIX;
+  int fd = open(cache_path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(img_cache_header_t)) {
+    close(fd);
+    return false;
+  }
+  uint64_t size = st.st_size;
+  void* base = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (base == MAP_FAILED)
+    return false;
+
+  auto header = (const img_cache_header_t*)base;
+  bool valid = header->magic == key.magic
+            && header->path_hash == key.path_hash
+            && header->src_size  == key.src_size
+            && header->src_mtime == key.src_mtime
+            && header->src_hash  == key.src_hash;
+
+  // validate the segment table before touching memory
+  uint64_t offset = sizeof(img_cache_header_t);
+  for (uint64_t i = 0; valid && i < header->num_segments; ++i) {
+    if (offset + sizeof(img_cache_segment_t) > size) {
+      valid = false;
+      break;
     }
-    if (size <= 1)
+    auto segment = (const img_cache_segment_t*)((const uint8_t*)base + offset);
+    // reject sizes past the end before rounding them, they could wrap around
+    if (segment->size > size - offset - sizeof(img_cache_segment_t)) {
+      valid = false;
       break;
-    ++line;
-    --size;
+    }
+    offset += sizeof(img_cache_segment_t) + ((segment->size + 7) & ~7ull);
+    valid = (offset <= size);
+  }
+
+  if (valid) {
+    this->clear();
+    offset = sizeof(img_cache_header_t);
+    for (uint64_t i = 0; i < header->num_segments; ++i) {
+      auto segment = (const img_cache_segment_t*)((const uint8_t*)base + offset);
+      this->write(segment + 1, segment->addr, segment->size);
+      offset += sizeof(img_cache_segment_t) + ((segment->size + 7) & ~7ull);
+    }
+  }
+
+  munmap(base, size);
+  return valid;
+}
+
+void RAM::saveImageCache(const char* filename, const std::vector<segment_t>& segments) {
+  img_cache_header_t header;
+  if (!img_cache_key(filename, &header))
+    return;
+  header.num_segments = segments.size();
+
+  std::vector<uint8_t> buffer((const uint8_t*)&header, (const uint8_t*)(&header + 1));
+  for (auto& segment : segments) {
+    img_cache_segment_t entry{segment.addr, segment.size};
+    uint64_t offset = buffer.size();
+    buffer.resize(offset + sizeof(entry) + ((segment.size + 7) & ~7ull), 0);
+    memcpy(buffer.data() + offset, &entry, sizeof(entry));
+    this->read(buffer.data() + offset + sizeof(entry), segment.addr, segment.size);
   }
+
+  // write to a temporary file then rename it, so that concurrent runs
+  // never observe a partially written cache.
+  std::string cache_path = std::string(filename) + IMG_CACHE_SUFFIX;
+  std::string tmp_path = cache_path + "." + std::to_string(getpid());
+  int fd = open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+    return;
+  ssize_t bytes = ::write(fd, buffer.data(), buffer.size());
+  close(fd);
+  if (bytes != (ssize_t)buffer.size()
+   || rename(tmp_path.c_str(), cache_path.c_str()) != 0) {
+    unlink(tmp_path.c_str());
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+[[noreturn]] static void elf_error(const char* filename, const char* msg) {
+  std::cout << "error: " << filename << ": " << msg << std::endl;
+  std::abort();
+}
+
+uint64_t RAM::loadElfImage(const char* filename, SymbolTable* symbols) {
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0) {
+    std::cout << "error: " << filename << " not found" << std::endl;
+    std::abort();
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(Elf32_Ehdr)) {
+    close(fd);
+    elf_error(filename, "truncated ELF header");
+  }
+  uint64_t size = st.st_size;
+  auto base = (const uint8_t*)mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (base == MAP_FAILED) {
+    elf_error(filename, "cannot map file");
+  }
+
+  auto ehdr = (const Elf32_Ehdr*)base;
+  if (memcmp(ehdr->e_ident, ELFMAG, SELFMAG) != 0)
+    elf_error(filename, "not an ELF file");
+  if (ehdr->e_ident[EI_CLASS] != ELFCLASS32)
+    elf_error(filename, "not a 32-bit ELF file");
+  if (ehdr->e_ident[EI_DATA] != ELFDATA2LSB)
+    elf_error(filename, "not a little-endian ELF file");
+  if (ehdr->e_machine != EM_RISCV)
+    elf_error(filename, "not a RISC-V ELF file");
+  if (ehdr->e_type != ET_EXEC)
+    elf_error(filename, "not an executable ELF file");
+
+  // sanity check a table location against the file size
+  auto in_file = [&](uint64_t offset, uint64_t count, uint64_t entsize) {
+    return offset <= size && count * entsize <= size - offset;
+  };
+
+  if (ehdr->e_phnum != 0
+   && (ehdr->e_phentsize != sizeof(Elf32_Phdr)
+    || !in_file(ehdr->e_phoff, ehdr->e_phnum, sizeof(Elf32_Phdr))))
+    elf_error(filename, "invalid program header table");
+
+  this->clear();
+
+  // map loadable segments, .bss is zero-filled on first touch.
+  // RAM is physical memory and the core starts with translation off,
+  // so segments go to their load address (p_paddr), as a boot loader
+  // would place them. it equals p_vaddr unless the link relocates them.
+  auto phdrs = (const Elf32_Phdr*)(base + ehdr->e_phoff);
+  for (uint32_t i = 0; i < ehdr->e_phnum; ++i) {
+    auto& phdr = phdrs[i];
+    if (phdr.p_type != PT_LOAD)
+      continue;
+    if (phdr.p_filesz > phdr.p_memsz
+     || !in_file(phdr.p_offset, phdr.p_filesz, 1))
+      elf_error(filename, "invalid loadable segment");
+    this->write(base + phdr.p_offset, phdr.p_paddr, phdr.p_filesz);
+    this->zeroFill(phdr.p_paddr + phdr.p_filesz, phdr.p_memsz - phdr.p_filesz);
+  }
+
+  // collect function and label symbols
+  if (symbols
+   && ehdr->e_shnum != 0
+   && ehdr->e_shentsize == sizeof(Elf32_Shdr)
+   && in_file(ehdr->e_shoff, ehdr->e_shnum, sizeof(Elf32_Shdr))) {
+    auto shdrs = (const Elf32_Shdr*)(base + ehdr->e_shoff);
+    symbols->clear();
+    for (uint32_t i = 0; i < ehdr->e_shnum; ++i) {
+      auto& symtab = shdrs[i];
+      if (symtab.sh_type != SHT_SYMTAB
+       || symtab.sh_link >= ehdr->e_shnum
+       || symtab.sh_entsize != sizeof(Elf32_Sym)
+       || !in_file(symtab.sh_offset, symtab.sh_size, 1))
+        continue;
+      auto& strtab = shdrs[symtab.sh_link];
+      if (!in_file(strtab.sh_offset, strtab.sh_size, 1))
+        continue;
+      auto syms = (const Elf32_Sym*)(base + symtab.sh_offset);
+      auto strs = (const char*)(base + strtab.sh_offset);
+      uint32_t num_syms = symtab.sh_size / sizeof(Elf32_Sym);
+      for (uint32_t j = 0; j < num_syms; ++j) {
+        auto& sym = syms[j];
+        auto type = ELF32_ST_TYPE(sym.st_info);
+        if ((type != STT_FUNC && type != STT_NOTYPE)
+         || sym.st_shndx == SHN_UNDEF
+         || sym.st_shndx == SHN_ABS
+         || sym.st_name >= strtab.sh_size)
+          continue;
+        const char* name = strs + sym.st_name;
+        auto len = strnlen(name, strtab.sh_size - sym.st_name);
+        // skip anonymous and assembler-local labels
+        if (len == 0 || name[0] == '$' || (name[0] == '.' && name[1] == 'L'))
+          continue;
+        symbols->add(sym.st_value, sym.st_size, std::string(name, len));
+      }
+    }
+    symbols->sort();
+  }
+
+  uint64_t entry = ehdr->e_entry;
+  munmap((void*)base, size);
+  return entry;
 }
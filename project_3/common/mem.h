@@ -19,6 +19,9 @@
 #include <cstdint>
 
 namespace tinyrv {
+
+class SymbolTable;
+
 struct BadAddress {};
 struct OutOfRange {};
 
@@ -81,20 +84,95 @@ public:
     bool      notFound;
   };
 
-  MemoryUnit(uint64_t pageSize = 0);
+  enum AccessType {
+    ACCESS_FETCH,
+    ACCESS_LOAD,
+    ACCESS_STORE
+  };
+
+  // where the last translation was resolved
+  enum {
+    XLAT_NONE,
+    XLAT_L1,
+    XLAT_L2,
+    XLAT_WALK
+  };
+
+  struct Translation {
+    uint32_t level;         // XLAT_*
+    uint32_t num_ptes;      // page table entries read by the walk
+    uint64_t pte_addr[2];
+  };
+
+  // TLB geometries (sets x ways)
+  struct TLBConfig {
+    uint32_t itlb_sets, itlb_ways;
+    uint32_t dtlb_sets, dtlb_ways;
+    uint32_t l2tlb_sets, l2tlb_ways;
+
+    TLBConfig(uint32_t is = 4, uint32_t iw = 4,
+              uint32_t ds = 4, uint32_t dw = 4,
+              uint32_t ls = 32, uint32_t lw = 4)
+      : itlb_sets(is), itlb_ways(iw)
+      , dtlb_sets(ds), dtlb_ways(dw)
+      , l2tlb_sets(ls), l2tlb_ways(lw)
+    {}
+  };
+
+  struct PerfStats {
+    uint64_t itlb_hits;
+    uint64_t itlb_misses;
+    uint64_t dtlb_hits;
+    uint64_t dtlb_misses;
+    uint64_t l2tlb_hits;
+    uint64_t l2tlb_misses;
+    uint64_t pte_reads;
+
+    PerfStats()
+      : itlb_hits(0)
+      , itlb_misses(0)
+      , dtlb_hits(0)
+      , dtlb_misses(0)
+      , l2tlb_hits(0)
+      , l2tlb_misses(0)
+      , pte_reads(0)
+    {}
+  };
+
+  MemoryUnit(uint64_t pageSize = 0, const TLBConfig& tlbConfig = TLBConfig());
 
   void attach(MemDevice &m, uint64_t start, uint64_t end);
 
   void read(void* data, uint64_t addr, uint64_t size, bool sup);
   void write(const void* data, uint64_t addr, uint64_t size, bool sup);
 
+  // instruction fetch, translated through the instruction TLB
+  void fetch(void* data, uint64_t addr, uint64_t size);
+
   void amo_reserve(uint64_t addr);
   bool amo_check(uint64_t addr);
 
+  // Sv32 translation is enabled when satp.MODE is set
+  void set_satp(uint32_t satp);
+  uint32_t get_satp() const {
+    return satp_;
+  }
+
+  // SFENCE.VMA, a zero rs1/rs2 register selects all addresses/ASIDs
+  void sfence(bool use_vaddr, uint64_t vaddr, bool use_asid, uint32_t asid);
+
+  const Translation& last_translation() const {
+    return xlat_;
+  }
+
+  const PerfStats& perf_stats() const {
+    return perf_stats_;
+  }
+
   void tlbAdd(uint64_t virt, uint64_t phys, uint32_t flags);
   void tlbRm(uint64_t vaddr);
   void tlbFlush() {
-    tlb_.clear();
+    l2tlb_.flush(false, 0, false, 0);
   }
 
 private:
@@ -141,19 +219,54 @@ private:
     uint32_t flags;
   };
 
+  // fixed-size set-associative TLB with LRU replacement,
+  // entries match their ASID unless global.
+  class TLB {
+  public:
+    TLB(uint32_t sets, uint32_t ways);
+
+    const TLBEntry* lookup(uint64_t vpn, uint32_t asid);
+
+    void insert(uint64_t vpn, const TLBEntry& entry, uint32_t asid, bool global);
+
+    void flush(bool use_vpn, uint64_t vpn, bool use_asid, uint32_t asid);
+
+  private:
+    struct way_t {
+      bool     valid;
+      bool     global;
+      uint32_t asid;
+      uint64_t vpn;
+      TLBEntry entry;
+      uint64_t stamp;
+    };
+
+    std::vector<way_t> ways_;
+    uint32_t num_sets_;
+    uint32_t num_ways_;
+    uint64_t clock_;
+  };
+
   TLBEntry tlbLookup(uint64_t vAddr, uint32_t flagMask);
 
-  uint64_t toPhyAddr(uint64_t vAddr, uint32_t flagMask);
+  TLBEntry sv32Walk(uint64_t vAddr);
+
+  uint64_t toPhyAddr(uint64_t vAddr, AccessType type, bool sup);
 
-  std::unordered_map<uint64_t, TLBEntry> tlb_;
+  TLB       itlb_;
+  TLB       dtlb_;
+  TLB       l2tlb_;
   uint64_t  pageSize_;
   ADecoder  decoder_;  
   bool      enableVM_;
+  uint32_t  satp_;
+  Translation xlat_;
+  PerfStats perf_stats_;
 
   amo_reservation_t amo_reservation_;
 };
 
-///////////////////////////////////////////////////////////////////////////////
+///////////
 
 class RAM : public MemDevice {
 public:
@@ -169,7 +282,11 @@ public:
   void write(const void* data, uint64_t addr, uint64_t size) override;
 
   void loadBinImage(const char* filename, uint64_t destination);
-  void loadHexImage(const char* filename);
+  void loadHexImage(const char* filename, bool use_cache = false);
+  uint64_t loadElfImage(const char* filename, SymbolTable* symbols = nullptr);
+
+  // zero-fill a range on first touch (e.g. ELF .bss)
+  void zeroFill(uint64_t addr, uint64_t size);
 
   uint8_t& operator[](uint64_t address) {
     return *this->get(address);
@@ -181,11 +298,20 @@ public:
 
 private:
 
+  struct segment_t {
+    uint64_t addr;
+    uint64_t size;
+  };
+
   uint8_t *get(uint64_t address) const;
 
+  bool loadImageCache(const char* filename);
+  void saveImageCache(const char* filename, const std::vector<segment_t>& segments);
+
   uint64_t capacity_;
   uint32_t page_bits_;  
   mutable std::unordered_map<uint64_t, uint8_t*> pages_;
+  std::vector<segment_t> zero_ranges_;
   mutable uint8_t* last_page_;
   mutable uint64_t last_page_index_;
 };
@@ -81,7 +81,7 @@ public:
   }
 
   const Pkt& front() const {
-    return queue_.front();
+    return queue_.front().pkt;
   }
 
   Pkt& front() {
@@ -89,7 +89,7 @@ public:
   }
 
   const Pkt& back() const {
-    return queue_.back();
+    return queue_.back().pkt;
   }
 
   Pkt& back() {
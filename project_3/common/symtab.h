@@ -0,0 +1,77 @@
+// Copyright 2024 Blaise Tine
+// 
+// Licensed under the Apache License;
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+namespace tinyrv {
+
+// program symbols sorted by address, used to name PCs in traces and profiles
+class SymbolTable {
+public:
+  struct symbol_t {
+    uint64_t    addr;
+    uint64_t    size;
+    std::string name;
+  };
+
+  SymbolTable() {}
+  ~SymbolTable() {}
+
+  void add(uint64_t addr, uint64_t size, const std::string& name) {
+    symbols_.push_back({addr, size, name});
+  }
+
+  void sort() {
+    std::stable_sort(symbols_.begin(), symbols_.end(),
+      [](const symbol_t& a, const symbol_t& b) { return a.addr < b.addr; });
+  }
+
+  // return the index of the symbol covering addr, or -1 if none
+  int lookup(uint64_t addr) const {
+    auto it = std::upper_bound(symbols_.begin(), symbols_.end(), addr,
+      [](uint64_t a, const symbol_t& s) { return a < s.addr; });
+    if (it == symbols_.begin())
+      return -1;
+    --it;
+    // sized symbols must contain the address
+    if (it->size != 0 && addr >= it->addr + it->size)
+      return -1;
+    return int(it - symbols_.begin());
+  }
+
+  const symbol_t& get(int index) const {
+    return symbols_.at(index);
+  }
+
+  uint32_t size() const {
+    return symbols_.size();
+  }
+
+  bool empty() const {
+    return symbols_.empty();
+  }
+
+  void clear() {
+    symbols_.clear();
+  }
+
+private:
+  std::vector<symbol_t> symbols_;
+};
+
+}
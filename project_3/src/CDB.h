@@ -13,6 +13,7 @@
 
 #pragma once
 
+#include <vector>
 #include <simobject.h>
 #include "instr.h"
 
@@ -27,30 +28,41 @@ public:
     int      rs_index;
   };
 
-  CommonDataBus() : empty_(true) {}
+  // width: number of results broadcast per cycle
+  CommonDataBus(uint32_t width = 1) : width_(width) {
+    data_.reserve(width);
+  }
 
   ~CommonDataBus() {}
 
   bool empty() const {
-    return empty_;
+    return data_.empty();
+  }
+
+  bool full() const {
+    return data_.size() == width_;
+  }
+
+  uint32_t size() const {
+    return data_.size();
   }
 
-  const data_t& data() const {
-    return data_;
+  const data_t& data(uint32_t index = 0) const {
+    return data_.at(index);
   }
 
   void push(uint32_t result, int rob_index, int rs_index) {
-    data_ = {result, rob_index, rs_index};
-    empty_ = false;
+    assert(!this->full());
+    data_.push_back({result, rob_index, rs_index});
   }
 
   void pop() {
-    empty_ = true;
+    data_.clear();
   }
 
 private:
-  bool   empty_;
-  data_t data_;
+  uint32_t width_;
+  std::vector<data_t> data_;
 };
 
 }
\ No newline at end of file
@@ -23,6 +23,13 @@ static uint32_t execute_alu_op(const Instr &instr, uint32_t rs1_data, uint32_t r
   auto exe_flags  = instr.getExeFlags();
   auto alu_op     = instr.getAluOp();
 
+  // a fused pair executes its first instruction,
+  // whose result replaces rs1 of the second one
+  if (instr.getFused()) {
+    rs1_data = execute_alu_op(*instr.getFused(), rs1_data, rs2_data);
+    rs2_data = 0;
+  }
+
   uint32_t alu_s1 = exe_flags.alu_s1_PC ? instr.getPC() : (exe_flags.alu_s1_rs1 ? instr.getRs1() :  rs1_data);
   uint32_t alu_s2 = exe_flags.alu_s2_imm ? instr.getImm() : rs2_data;
 
@@ -134,59 +141,382 @@ void ALU::do_execute() {
 
 void BRU::do_execute() {
   auto br_op = instr_->getBrOp();
-  auto br_taken = execute_br_op(br_op, rs1_value_, rs2_value_);
+  uint32_t rs1_value = rs1_value_;
+  uint32_t rs2_value = rs2_value_;
+  if (instr_->getFused() && br_op != BrOp::JALR) {
+    // fused compare and branch: write the comparison and test it against x0
+    rs1_value = execute_alu_op(*instr_->getFused(), rs1_value_, rs2_value_);
+    rs2_value = 0;
+    result_ = rs1_value;
+  }
+  auto br_taken = execute_br_op(br_op, rs1_value, rs2_value);
+  uint32_t next_PC = instr_->getPC() + 4;
   if (br_taken) {
-    auto br_target = execute_alu_op(*instr_, rs1_value_, rs2_value_);
-    core_->PC_ = br_target;
+    next_PC = execute_alu_op(*instr_, rs1_value_, rs2_value_);
     if (br_op == BrOp::JAL || br_op == BrOp::JALR) {
       result_ = instr_->getPC() + 4; // return PC + 4
     }
   }
-  DT(2, "Branch: " << (br_taken ? "taken" : "not-taken") << ", target=0x" << std::hex << core_->PC_ << std::dec << " (#" << instr_->getId() << ")");
-  core_->fetch_stalled_->write(false); // release fetch stage
+  instr_->setNextPC(next_PC);
+  DT(2, "Branch: " << (br_taken ? "taken" : "not-taken") << ", target=0x" << std::hex << next_PC << std::dec << " (#" << instr_->getId() << ")");
+  if (core_->bpred_) {
+    // fetch went on along the predicted path, restart it if wrong
+    if (next_PC != instr_->getPredPC()) {
+      DT(2, "*** Branch misprediction: predicted=0x" << std::hex << instr_->getPredPC() << std::dec << " (#" << instr_->getId() << ")");
+      core_->recover(rob_index_, next_PC);
+    }
+  } else {
+    if (br_taken) {
+      core_->PC_ = next_PC;
+    }
+    core_->fetch_stalled_->write(false); // release fetch stage
+  }
+}
+
+static uint32_t load_result(uint32_t func3, uint32_t read_data) {
+  uint32_t data_width = 8 * (1 << (func3 & 0x3));
+  switch (func3) {
+  case 0: // RV32I: LB
+  case 1: // RV32I: LH
+    return sext(read_data, data_width);
+  case 2: // RV32I: LW
+    return sext(read_data, data_width);
+  case 4: // RV32I: LBU
+  case 5: // RV32I: LHU
+    return read_data;
+  default:
+    std::abort();
+  }
+  return 0;
 }
 
 void LSU::do_execute() {
-  auto exe_flags = instr_->getExeFlags();
   auto func3 = instr_->getFunc3();
+  assert(instr_->getExeFlags().is_load);
+  uint64_t mem_addr = execute_alu_op(*instr_, rs1_value_, rs2_value_);
+  uint32_t data_bytes = 1 << (func3 & 0x3);
+  uint32_t read_data = 0;
+  core_->dmem_read(&read_data, mem_addr, data_bytes);
+  result_ = load_result(func3, read_data);
+}
 
-  if (exe_flags.is_load) {
-    uint64_t mem_addr = execute_alu_op(*instr_, rs1_value_, rs2_value_);
-    uint32_t data_bytes = 1 << (func3 & 0x3);
-    uint32_t data_width = 8 * data_bytes;
-    uint32_t read_data = 0;
-    core_->dmem_read(&read_data, mem_addr, data_bytes);
-    switch (func3) {
-    case 0: // RV32I: LB
-    case 1: // RV32I: LH
-      result_ = sext(read_data, data_width);
-      break;
-    case 2: // RV32I: LW
-      result_ = sext(read_data, data_width);
-      break;
-    case 4: // RV32I: LBU
-    case 5: // RV32I: LHU
-      result_ = read_data;
-      break;
-    default:
-      std::abort();
-    }
-  } else if (exe_flags.is_store) {
-    uint64_t mem_addr = execute_alu_op(*instr_, rs1_value_, rs2_value_);
-    uint32_t data_bytes = 1 << (func3 & 0x3);
-    switch (func3) {
-    case 0:
-    case 1:
-    case 2:
-      core_->dmem_write(&rs2_value_, mem_addr, data_bytes);
+LSU::LSU(Core* core)
+  : FunctionalUnit(LSU_LATENCY, LSU_LATENCY)
+  , core_(core)
+  , mshrs_(LSU_MSHRS, mshr_t{false, false, 0, 0})
+  , free_mshrs_(LSU_MSHRS)
+  , issued_(0)
+  , xlat_ready_(0)
+  , violation_(-1)
+  , violation_uuid_(0)
+{
+  mem_port_ = core->mem_attach("lsu", [this](uint32_t tag) {
+    this->mem_response(tag);
+  });
+}
+
+void LSU::execute() {
+  uint64_t now = SimPlatform::instance().cycles();
+  issued_ = 0;
+
+  // flush from a load that missed an older store, unless it was already squashed
+  if (violation_ != -1) {
+    auto& entry = core_->ROB_.get_entry(violation_);
+    if (core_->ROB_.valid(violation_) && entry.instr->getId() == violation_uuid_) {
+      core_->recover(core_->ROB_.prev_index(violation_), entry.instr->getPC());
+    }
+    violation_ = -1;
+  }
+
+  // release filled MSHRs
+  for (auto& mshr : mshrs_) {
+    if (mshr.valid && mshr.ready <= now) {
+      mshr.valid = false;
+      ++free_mshrs_;
+    }
+  }
+
+  if (free_mshrs_ == 0) {
+    ++perf_stats_.mshr_full_cycles;
+  }
+}
+
+bool LSU::busy() const {
+  // accept one request per pipe and cycle, provided a miss could be tracked
+  return issued_ == NUM_LSUS
+      || requests_.size() >= LSU_QUEUE_SIZE
+      || free_mshrs_ == 0
+      || xlat_ready_ > SimPlatform::instance().cycles();
+}
+
+int LSU::ready_request() const {
+  // oldest completed request
+  uint64_t now = SimPlatform::instance().cycles();
+  for (int i = 0; i < (int)requests_.size(); ++i) {
+    if (requests_[i].ready <= now)
+      return i;
+  }
+  return -1;
+}
+
+bool LSU::done() const {
+  return this->ready_request() != -1;
+}
+
+FunctionalUnit::data_out_t LSU::get_output() const {
+  int index = this->ready_request();
+  assert(index != -1);
+  auto& req = requests_.at(index);
+  return {req.rob_index, req.rs_index, req.result};
+}
+
+void LSU::clear() {
+  int index = this->ready_request();
+  assert(index != -1);
+  requests_.erase(requests_.begin() + index);
+}
+
+void LSU::squash(const ReorderBuffer& ROB) {
+  // in-flight misses still fill their MSHRs
+  for (auto it = requests_.begin(); it != requests_.end();) {
+    if (!ROB.valid(it->rob_index)) {
+      it = requests_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+int LSU::allocate_mshr(uint64_t line, bool cached, uint64_t ready) {
+  assert(free_mshrs_ != 0);
+  for (int i = 0; i < (int)mshrs_.size(); ++i) {
+    auto& mshr = mshrs_[i];
+    if (!mshr.valid) {
+      mshr = {true, cached, line, ready};
+      --free_mshrs_;
+      return i;
+    }
+  }
+  std::abort();
+  return -1;
+}
+
+int LSU::find_mshr(uint64_t line) const {
+  for (int i = 0; i < (int)mshrs_.size(); ++i) {
+    auto& mshr = mshrs_[i];
+    if (mshr.valid && mshr.cached && mshr.line == line)
+      return i;
+  }
+  return -1;
+}
+
+void LSU::prefetch(uint32_t PC, uint64_t addr, bool miss) {
+  auto& prefetcher = core_->prefetcher_;
+  uint32_t count = prefetcher.train(PC, addr, miss);
+  uint64_t line_size = core_->dcache_.config().line_size;
+  for (uint32_t i = 0; i < count; ++i) {
+    uint64_t line = prefetcher.candidate(i);
+    uint64_t line_addr = line * line_size;
+    // skip lines already present or in flight
+    if (get_addr_type(line_addr) == AddrType::IO
+     || core_->dcache_.contains(line_addr)
+     || this->find_mshr(line) != -1
+     || prefetcher.lookup(line) != -1)
+      continue;
+    uint64_t ready = DRAM_ENABLED ? Prefetcher::PENDING :
+      (SimPlatform::instance().cycles() + core_->dcache_.latency(false));
+    int slot = prefetcher.allocate(line, ready);
+    if (slot == -1)
       break;
-    default:
-      std::abort();
+    if (DRAM_ENABLED) {
+      core_->mem_request(mem_port_, MemReq{line_addr, false, mem_tag(MEM_TAG_PREFETCH, slot)});
+    }
+  }
+}
+
+void LSU::mem_response(uint32_t tag) {
+  uint32_t index = tag & 0xffff;
+  switch (tag >> 16) {
+  case MEM_TAG_FILL:
+    this->fill(index);
+    break;
+  case MEM_TAG_PREFETCH: {
+    // forward to the demand miss waiting for this line
+    int mshr = core_->prefetcher_.fill(index);
+    if (mshr != -1) {
+      this->fill(mshr);
     }
+  } break;
+  default:
+    break;
   }
 }
 
+void LSU::fill(int mshr_index) {
+  auto& mshr = mshrs_.at(mshr_index);
+  assert(mshr.valid && mshr.ready == PENDING);
+  mshr.ready = SimPlatform::instance().cycles() + core_->dcache_.latency(true);
+  for (auto& req : requests_) {
+    if (req.mshr == mshr_index) {
+      req.ready = mshr.ready;
+      req.mshr = -1;
+    }
+  }
+}
+
+bool LSU::store(uint64_t addr, uint32_t data, uint32_t size) {
+  bool cached = DCACHE_ENABLED && get_addr_type(addr) != AddrType::IO;
+  uint64_t line = core_->dcache_.line_addr(addr);
+
+  // a write-allocate miss fetches its line in the background
+  bool fill = cached && DRAM_ENABLED
+           && core_->dcache_.config().write_allocate
+           && !core_->dcache_.contains(addr)
+           && this->find_mshr(line) == -1;
+  if (fill && free_mshrs_ == 0)
+    return false;
+
+  core_->dmem_write(&data, addr, size);
+  ++perf_stats_.stores;
+
+  if (core_->stack_dist_ && get_addr_type(addr) != AddrType::IO) {
+    core_->stack_dist_->access(addr);
+  }
+
+  if (cached) {
+    uint64_t wb_addr = Cache::NO_WRITEBACK;
+    core_->dcache_.access(addr, true, &wb_addr);
+    uint64_t line_size = core_->dcache_.config().line_size;
+    if (fill) {
+      int mshr = this->allocate_mshr(line, true, PENDING);
+      core_->mem_request(mem_port_, MemReq{line * line_size, false, mem_tag(MEM_TAG_FILL, mshr)}, core_->dmem_xlat_);
+    }
+    if (DRAM_ENABLED && wb_addr != Cache::NO_WRITEBACK) {
+      core_->mem_request(mem_port_, MemReq{wb_addr, true, mem_tag(MEM_TAG_WRITEBACK, 0)}, core_->dmem_xlat_);
+    }
+  }
+  return true;
+}
+
+void LSU::issue(Instr::Ptr instr, int rob_index, int rs_index, uint32_t rs1_value, uint32_t rs2_value) {
+  assert(!this->busy());
+  instr_     = instr;
+  rs1_value_ = rs1_value;
+  rs2_value_ = rs2_value;
+  ++issued_;
+
+  auto exe_flags = instr->getExeFlags();
+  uint64_t mem_addr = execute_alu_op(*instr, rs1_value, rs2_value);
+  uint32_t data_bytes = 1 << (instr->getFunc3() & 0x3);
+  uint64_t cycles = SimPlatform::instance().cycles();
+  auto& LSQ = core_->LSQ_;
+
+  if (exe_flags.is_store) {
+    // hand the address and data to the store queue, memory is written at commit
+    int violation = LSQ.execute_store(rob_index, mem_addr, data_bytes, rs2_value);
+    core_->store_sets_.execute_store(instr->getPC(), instr->getId());
+    requests_.push_back({rob_index, rs_index, 0, cycles + 1, -1});
+    if (violation != -1
+     && (violation_ == -1 || core_->ROB_.age(violation) < core_->ROB_.age(violation_))) {
+      // a younger load read stale data, train the predictor
+      // and refetch the load next cycle, the oldest one of this cycle
+      auto& load = *core_->ROB_.get_entry(violation).instr;
+      DT(2, "*** Memory order violation: load PC=0x" << std::hex << load.getPC() << ", store PC=0x" << instr->getPC() << std::dec << " (#" << load.getId() << ")");
+      core_->store_sets_.violation(load.getPC(), instr->getPC());
+      violation_ = violation;
+      violation_uuid_ = load.getId();
+    }
+    return;
+  }
+
+  uint32_t fwd_data;
+  if (LSQ.execute_load(rob_index, mem_addr, data_bytes, &fwd_data) == LoadStoreQueue::LOAD_FORWARD) {
+    // data forwarded from an older store, no memory access
+    result_ = load_result(instr->getFunc3(), fwd_data);
+    ++perf_stats_.loads;
+    requests_.push_back({rob_index, rs_index, result_, cycles + DCACHE_HIT_LATENCY, -1});
+    return;
+  }
+
+  // access memory now
+  this->do_execute();
+
+  // address translation delays the access and blocks the unit
+  uint32_t xlat = core_->dmem_xlat_;
+  uint64_t now = cycles + xlat;
+  xlat_ready_ = now;
+  uint64_t ready;
+  int pending = -1;
+
+  ++perf_stats_.loads;
+
+  if (core_->stack_dist_ && get_addr_type(mem_addr) != AddrType::IO) {
+    core_->stack_dist_->access(mem_addr);
+  }
+
+  if (!DCACHE_ENABLED) {
+    // flat memory latency
+    ready = mshrs_.at(this->allocate_mshr(0, false, now + LSU_LATENCY)).ready;
+  } else if (get_addr_type(mem_addr) == AddrType::IO) {
+    // I/O accesses bypass the data cache
+    ready = mshrs_.at(this->allocate_mshr(0, false, now + core_->dcache_.latency(false))).ready;
+  } else {
+    uint64_t line = core_->dcache_.line_addr(mem_addr);
+    uint64_t wb_addr = Cache::NO_WRITEBACK;
+    int merged = this->find_mshr(line);
+    int slot = -1;
+    bool miss = false;
+    if (merged != -1) {
+      // secondary miss, wait for the pending fill
+      ready = mshrs_[merged].ready;
+      if (ready == PENDING) {
+        pending = merged;
+      }
+      ++perf_stats_.mshr_merges;
+    } else if (core_->dcache_.access(mem_addr, false, &wb_addr)) {
+      ready = now + core_->dcache_.latency(true);
+    } else if ((slot = core_->prefetcher_.lookup(line)) != -1) {
+      // served by the prefetch buffer
+      if (core_->prefetcher_.pending(slot)) {
+        pending = this->allocate_mshr(line, true, PENDING);
+        ready = core_->prefetcher_.consume(slot, pending);
+      } else {
+        ready = std::max(now, core_->prefetcher_.consume(slot, -1)) + core_->dcache_.latency(true);
+      }
+    } else if (DRAM_ENABLED) {
+      // fetch the line from memory
+      pending = this->allocate_mshr(line, true, PENDING);
+      ready = PENDING;
+      uint64_t line_size = core_->dcache_.config().line_size;
+      core_->mem_request(mem_port_, MemReq{line * line_size, false, mem_tag(MEM_TAG_FILL, pending)}, xlat);
+      miss = true;
+    } else {
+      ready = mshrs_.at(this->allocate_mshr(line, true, now + core_->dcache_.latency(false))).ready;
+      miss = true;
+    }
+    if (DRAM_ENABLED && wb_addr != Cache::NO_WRITEBACK) {
+      // write traffic does not block the pipeline
+      core_->mem_request(mem_port_, MemReq{wb_addr, true, mem_tag(MEM_TAG_WRITEBACK, 0)}, xlat);
+    }
+    if (core_->prefetcher_.enabled()) {
+      this->prefetch(instr->getPC(), mem_addr, miss);
+    }
+  }
+
+  requests_.push_back({rob_index, rs_index, result_, ready, pending});
+  perf_stats_.max_inflight = std::max<uint32_t>(perf_stats_.max_inflight, requests_.size());
+}
+
 void SFU::do_execute() {
+  if (Core::is_serializing(*instr_)) {
+    core_->fetch_stalled_->write(false); // release fetch stage
+  }
+  if (instr_->getExeFlags().is_sfence) {
+    // x0 operands select all addresses or all ASIDs
+    core_->mmu_.sfence(instr_->getRs1() != 0, rs1_value_, instr_->getRs2() != 0, rs2_value_);
+    result_ = 0;
+    return;
+  }
   auto csr_data = core_->get_csr(instr_->getImm());
   auto rd_data = execute_alu_op(*instr_, rs1_value_, csr_data);
   if (rd_data != csr_data) {
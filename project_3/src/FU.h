@@ -13,12 +13,22 @@
 
 #pragma once
 
+#include <vector>
+#include <assert.h>
+#include <util.h>
 #include "instr.h"
+#include "ROB.h"
 
 namespace tinyrv {
 
 class Core;
 
+// Pipelined functional unit.
+// An operation enters every `interval` cycles and completes after `latency`
+// cycles, the in-flight operations are held in a ring of latency / interval
+// slots and leave the unit in issue order. A completed operation holds its
+// slot until its result is taken from the unit, which stalls the ones behind
+// it. The interval defaults to the latency, which is a single-occupancy unit.
 class FunctionalUnit {
 public:
   typedef std::shared_ptr<FunctionalUnit> Ptr;
@@ -29,51 +39,97 @@ public:
     uint32_t result;
   };
 
-  FunctionalUnit(uint32_t latency)
+  FunctionalUnit(uint32_t latency, uint32_t interval)
     : latency_(latency)
-    , cycles_(0)
-    , busy_(false)
-    , done_(false)
-  {}
+    , interval_(interval)
+    , slots_((latency + interval - 1) / interval)
+    , head_(0)
+    , size_(0)
+  {
+    assert(interval != 0 && interval <= latency);
+  }
 
   virtual ~FunctionalUnit() {}
 
-  void execute() {
-    if (!busy_ || done_)
-      return;
-
-    if (++cycles_ == latency_) {
-      this->do_execute();
-      done_ = true;
+  virtual void execute() {
+    // a mispredicted branch can squash slots of this unit on the way
+    uint32_t head = head_;
+    for (uint32_t i = 0; i < slots_.size(); ++i) {
+      auto& slot = slots_[(head + i) % slots_.size()];
+      if (!slot.valid || slot.done)
+        continue;
+      if (++slot.cycles == latency_) {
+        instr_     = slot.instr;
+        rob_index_ = slot.rob_index;
+        rs_index_  = slot.rs_index;
+        rs1_value_ = slot.rs1_value;
+        rs2_value_ = slot.rs2_value;
+        this->do_execute();
+        slot.result = result_;
+        slot.done   = true;
+      }
     }
   }
 
-  bool busy() const {
-    return busy_;
+  virtual bool busy() const {
+    // the youngest operation must have moved down interval stages
+    if (size_ == 0)
+      return false;
+    return size_ == slots_.size()
+        || slots_[(head_ + size_ - 1) % slots_.size()].cycles < interval_;
+  }
+
+  virtual bool done() const {
+    return size_ != 0 && slots_[head_].done;
+  }
+
+  // operations accepted and results returned per cycle
+  virtual uint32_t ports() const {
+    return 1;
+  }
+
+  // operations in flight
+  virtual uint32_t inflight() const {
+    return size_;
+  }
+
+  virtual data_out_t get_output() const {
+    auto& slot = slots_[head_];
+    return {slot.rob_index, slot.rs_index, slot.result};
   }
 
-  bool done() const {
-    return done_;
+  virtual void issue(Instr::Ptr instr, int rob_index, int rs_index, uint32_t rs1_value, uint32_t rs2_value) {
+    assert(!this->busy());
+    slots_[(head_ + size_) % slots_.size()] = {instr, rob_index, rs_index, rs1_value, rs2_value, 0, 0, true, false};
+    ++size_;
   }
 
-  data_out_t get_output() const {
-    return {rob_index_, rs_index_, result_};
+  // remove the oldest operation once its result was taken
+  virtual void clear() {
+    assert(size_ != 0);
+    slots_[head_].valid = false;
+    this->compact();
   }
 
-  void issue(Instr::Ptr instr, int rob_index, int rs_index, uint32_t rs1_value, uint32_t rs2_value) {
-    instr_     = instr;
-    rob_index_ = rob_index;
-    rs_index_  = rs_index;
-    rs1_value_ = rs1_value;
-    rs2_value_ = rs2_value;
-    busy_      = true;
-    done_      = false;
-    cycles_    = 0;
+  // drop the operation issued last cycle
+  virtual void cancel(int rob_index) {
+    assert(size_ != 0);
+    auto& slot = slots_[(head_ + size_ - 1) % slots_.size()];
+    assert(slot.valid && slot.rob_index == rob_index);
+    __unused (rob_index);
+    slot.valid = false;
+    this->compact();
   }
 
-  void clear() {
-    busy_ = false;
-    done_ = false;
+  // drop the instructions whose ROB entry was squashed
+  virtual void squash(const ReorderBuffer& ROB) {
+    for (uint32_t i = 0; i < size_; ++i) {
+      auto& slot = slots_[(head_ + i) % slots_.size()];
+      if (slot.valid && !ROB.valid(slot.rob_index)) {
+        slot.valid = false;
+      }
+    }
+    this->compact();
   }
 
 protected:
@@ -84,16 +140,39 @@ protected:
   uint32_t  rs1_value_;
   uint32_t  rs2_value_;
   uint32_t  result_;
+  int       rob_index_;
+  int       rs_index_;
 
 private:
 
-  int       rob_index_;
-  int       rs_index_;
+  struct slot_t {
+    Instr::Ptr instr;
+    int      rob_index;
+    int      rs_index;
+    uint32_t rs1_value;
+    uint32_t rs2_value;
+    uint32_t result;
+    uint32_t cycles;
+    bool     valid;
+    bool     done;
+  };
+
+  // release the dropped slots at both ends of the ring
+  void compact() {
+    while (size_ != 0 && !slots_[head_].valid) {
+      head_ = (head_ + 1) % slots_.size();
+      --size_;
+    }
+    while (size_ != 0 && !slots_[(head_ + size_ - 1) % slots_.size()].valid) {
+      --size_;
+    }
+  }
 
   uint32_t  latency_;
-  uint32_t  cycles_;
-  bool      busy_;
-  bool      done_;
+  uint32_t  interval_;
+  std::vector<slot_t> slots_;
+  uint32_t  head_;
+  uint32_t  size_;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -101,7 +180,7 @@ private:
 class ALU : public FunctionalUnit {
 public:
   ALU(Core* core)
-    : FunctionalUnit(ALU_LATENCY)
+    : FunctionalUnit(ALU_LATENCY, ALU_INTERVAL)
     , core_(core)
   {}
 
@@ -116,7 +195,7 @@ private:
 class BRU : public FunctionalUnit {
 public:
   BRU(Core* core)
-    : FunctionalUnit(BRU_LATENCY)
+    : FunctionalUnit(BRU_LATENCY, BRU_INTERVAL)
     , core_(core)
   {}
 
@@ -128,17 +207,121 @@ private:
 
 ///////////////////////////////////////////////////////////////////////////////
 
+// Non-blocking load/store unit.
+// Loads access memory functionally at issue, once the load/store queue has
+// cleared them against the older stores, then each request waits for its
+// modeled latency. Data cache misses allocate a miss status holding register
+// (MSHR), later misses to the same line merge into it, and results leave the
+// unit out of order as soon as they are ready. With DRAM_ENABLED, MSHRs stay
+// pending until the memory response calls fill(). Loads also train the data
+// prefetcher, whose buffer can serve later misses. Stores only record their
+// address and data at issue, store() writes them at commit.
 class LSU : public FunctionalUnit {
 public:
-  LSU(Core* core)
-    : FunctionalUnit(LSU_LATENCY)
-    , core_(core)
-  {}
+  struct PerfStats {
+    uint64_t loads;
+    uint64_t stores;
+    uint64_t mshr_merges;
+    uint64_t mshr_full_cycles;
+    uint32_t max_inflight;
+
+    PerfStats()
+      : loads(0)
+      , stores(0)
+      , mshr_merges(0)
+      , mshr_full_cycles(0)
+      , max_inflight(0)
+    {}
+  };
 
-  void do_execute();
+  LSU(Core* core);
+
+  void execute() override;
+
+  bool busy() const override;
+
+  bool done() const override;
+
+  uint32_t ports() const override {
+    return NUM_LSUS;
+  }
+
+  uint32_t inflight() const override {
+    return requests_.size();
+  }
+
+  data_out_t get_output() const override;
+
+  void issue(Instr::Ptr instr, int rob_index, int rs_index, uint32_t rs1_value, uint32_t rs2_value) override;
+
+  void clear() override;
+
+  void squash(const ReorderBuffer& ROB) override;
+
+  void do_execute() override;
+
+  // complete the memory fill of the given MSHR
+  void fill(int mshr_index);
+
+  // write a committed store to memory and the data cache,
+  // return false when its miss cannot be tracked yet
+  bool store(uint64_t addr, uint32_t data, uint32_t size);
+
+  const PerfStats& perf_stats() const {
+    return perf_stats_;
+  }
 
 private:
+
+  // fill cycle of an MSHR waiting for memory
+  static constexpr uint64_t PENDING = uint64_t(-1);
+
+  struct request_t {
+    int      rob_index;
+    int      rs_index;
+    uint32_t result;
+    uint64_t ready;   // completion cycle
+    int      mshr;    // pending MSHR, or -1
+  };
+
+  struct mshr_t {
+    bool     valid;
+    bool     cached;  // uncached requests never merge
+    uint64_t line;
+    uint64_t ready;   // fill cycle
+  };
+
+  // memory request tags: | type | index |
+  enum {
+    MEM_TAG_FILL,
+    MEM_TAG_WRITEBACK,
+    MEM_TAG_PREFETCH
+  };
+
+  static uint32_t mem_tag(uint32_t type, uint32_t index) {
+    return (type << 16) | index;
+  }
+
+  void mem_response(uint32_t tag);
+
+  int ready_request() const;
+
+  int allocate_mshr(uint64_t line, bool cached, uint64_t ready);
+
+  int find_mshr(uint64_t line) const;
+
+  void prefetch(uint32_t PC, uint64_t addr, bool miss);
+
   Core* core_;
+  uint32_t mem_port_;
+  std::vector<request_t> requests_;
+  std::vector<mshr_t> mshrs_;
+  uint32_t free_mshrs_;
+  uint32_t issued_;       // requests accepted this cycle
+  uint64_t xlat_ready_;   // end of the last address translation
+  int      violation_;    // load to refetch after an ordering violation, or -1
+  uint64_t violation_uuid_;
+  PerfStats perf_stats_;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -146,7 +329,7 @@ private:
 class SFU : public FunctionalUnit {
 public:
   SFU(Core* core)
-    : FunctionalUnit(SFU_LATENCY)
+    : FunctionalUnit(SFU_LATENCY, SFU_INTERVAL)
     , core_(core)
   {}
 
@@ -0,0 +1,184 @@
+// Copyright 2024 Blaise Tine
+//
+// Licensed under the Apache License;
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <iostream>
+#include <algorithm>
+#include <assert.h>
+#include <util.h>
+#include "types.h"
+#include "debug.h"
+#include "LSQ.h"
+
+using namespace tinyrv;
+
+LoadStoreQueue::LoadStoreQueue(uint32_t lq_size, uint32_t sq_size, uint32_t rob_size, bool speculative)
+  : seqs_(rob_size, 0)
+  , load_base_(0)
+  , store_base_(0)
+  , lq_size_(lq_size)
+  , sq_size_(sq_size)
+  , speculative_(speculative)
+{}
+
+LoadStoreQueue::~LoadStoreQueue() {
+  //--
+}
+
+void LoadStoreQueue::reset() {
+  loads_.clear();
+  stores_.clear();
+  load_base_ = 0;
+  store_base_ = 0;
+  perf_stats_ = PerfStats();
+}
+
+void LoadStoreQueue::allocate(const Instr& instr, int rob_index, uint64_t wait) {
+  bool is_store = instr.getExeFlags().is_store;
+  assert(!this->full(is_store));
+  auto& queue = is_store ? stores_ : loads_;
+  seqs_.at(rob_index) = (is_store ? store_base_ : load_base_) + queue.size();
+  queue.push_back({rob_index, instr.getId(), false, 0, 0, 0, wait, NO_STORE, false,
+                   store_base_ + stores_.size()});
+}
+
+LoadStoreQueue::entry_t* LoadStoreQueue::find(bool is_store, int rob_index) {
+  auto& queue = is_store ? stores_ : loads_;
+  uint64_t offset = seqs_.at(rob_index) - (is_store ? store_base_ : load_base_);
+  if (offset >= queue.size() || queue[offset].rob_index != rob_index)
+    return nullptr;
+  return &queue[offset];
+}
+
+int LoadStoreQueue::search(const entry_t& load, uint64_t addr, uint32_t size, const entry_t** store) const {
+  // search the older stores from the youngest
+  assert(load.stores - store_base_ <= stores_.size());
+  for (uint64_t i = load.stores - store_base_; i-- != 0;) {
+    auto& entry = stores_[i];
+    if (!entry.executed) {
+      if (!speculative_)
+        return LOAD_WAIT;
+      // speculate past it, unless it is the predicted dependence
+      if (entry.uuid == load.wait)
+        return LOAD_WAIT;
+      continue;
+    }
+    if (addr + size <= entry.addr || entry.addr + entry.size <= addr)
+      continue;
+    // partial overlaps wait for the store to commit
+    if (addr < entry.addr || addr + size > entry.addr + entry.size)
+      return LOAD_WAIT;
+    *store = &entry;
+    return LOAD_FORWARD;
+  }
+  return LOAD_MEMORY;
+}
+
+int LoadStoreQueue::disambiguate(int rob_index, uint64_t addr, uint32_t size) {
+  auto load = this->find(false, rob_index);
+  assert(load && !load->executed);
+  const entry_t* store = nullptr;
+  int status = this->search(*load, addr, size, &store);
+  if (status == LOAD_WAIT && !load->held && load->wait != NO_STORE) {
+    auto wait = std::find_if(stores_.begin(), stores_.end(), [&](const entry_t& entry) {
+      return entry.uuid == load->wait;
+    });
+    if (wait != stores_.end() && !wait->executed) {
+      load->held = true;
+      ++perf_stats_.held;
+    }
+  }
+  return status;
+}
+
+int LoadStoreQueue::execute_load(int rob_index, uint64_t addr, uint32_t size, uint32_t* data) {
+  auto load = this->find(false, rob_index);
+  assert(load && !load->executed);
+  load->executed = true;
+  load->addr = addr;
+  load->size = size;
+
+  for (auto& store : stores_) {
+    if (store.uuid > load->uuid)
+      break;
+    if (!store.executed) {
+      ++perf_stats_.speculative;
+      break;
+    }
+  }
+
+  if (load->held) {
+    // the predicted store may have left the queue at commit
+    for (auto& store : stores_) {
+      if (store.uuid == load->wait
+       && (addr + size <= store.addr || store.addr + store.size <= addr)) {
+        ++perf_stats_.false_deps;
+      }
+    }
+  }
+
+  const entry_t* store = nullptr;
+  int status = this->search(*load, addr, size, &store);
+  assert(status != LOAD_WAIT);
+  if (status == LOAD_FORWARD) {
+    uint32_t shift = 8 * (addr - store->addr);
+    uint32_t mask = (size == 4) ? 0xffffffff : ((1u << (8 * size)) - 1);
+    *data = (store->data >> shift) & mask;
+    load->source = store->uuid;
+    ++perf_stats_.forwards;
+  }
+  return status;
+}
+
+int LoadStoreQueue::execute_store(int rob_index, uint64_t addr, uint32_t size, uint32_t data) {
+  auto store = this->find(true, rob_index);
+  assert(store && !store->executed);
+  store->executed = true;
+  store->addr = addr;
+  store->size = size;
+  store->data = data;
+
+  // younger loads that already read memory, or an older store, missed this one
+  for (auto& load : loads_) {
+    if (load.uuid < store->uuid || !load.executed)
+      continue;
+    if (addr + size <= load.addr || load.addr + load.size <= addr)
+      continue;
+    if (load.source != NO_STORE && load.source > store->uuid)
+      continue;
+    ++perf_stats_.violations;
+    return load.rob_index;
+  }
+  return -1;
+}
+
+void LoadStoreQueue::commit(bool is_store) {
+  auto& queue = is_store ? stores_ : loads_;
+  assert(!queue.empty());
+  queue.pop_front();
+  ++(is_store ? store_base_ : load_base_);
+}
+
+void LoadStoreQueue::squash(const ReorderBuffer& ROB, StoreSetPredictor& store_sets) {
+  // squashed instructions are the youngest ones
+  while (!loads_.empty() && !ROB.valid(loads_.back().rob_index)) {
+    loads_.pop_back();
+  }
+  uint64_t uuid = NO_STORE;
+  while (!stores_.empty() && !ROB.valid(stores_.back().rob_index)) {
+    uuid = stores_.back().uuid;
+    stores_.pop_back();
+  }
+  if (uuid != NO_STORE) {
+    store_sets.squash(uuid);
+  }
+}
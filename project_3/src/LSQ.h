@@ -0,0 +1,133 @@
+// Copyright 2024 Blaise Tine
+//
+// Licensed under the Apache License;
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <deque>
+#include "instr.h"
+#include "ROB.h"
+#include "store_set.h"
+
+namespace tinyrv {
+
+// Load and store queues.
+// Memory instructions take an entry at issue, in program order, and leave
+// at commit. Stores record their address and data when they execute and
+// only write memory at commit. A load checks the older stores before it
+// executes: it takes its data from the youngest store that covers it, or
+// else reads memory. Older stores with an unknown address hold the load
+// back, unless the queue is speculative: the load then only waits for the
+// store predicted at issue, and a store whose address turns out to overlap
+// an already executed younger load reports an ordering violation.
+class LoadStoreQueue {
+public:
+  static constexpr uint64_t NO_STORE = StoreSetPredictor::NO_STORE;
+
+  struct entry_t {
+    int      rob_index;
+    uint64_t uuid;        // program order
+    bool     executed;    // address (and store data) known
+    uint64_t addr;
+    uint32_t size;
+    uint32_t data;
+    uint64_t wait;        // loads: predicted store dependence
+    uint64_t source;      // loads: store that forwarded the data
+    bool     held;        // loads: waited for the predicted store
+    uint64_t stores;      // loads: stores allocated before it
+  };
+
+  struct PerfStats {
+    uint64_t forwards;      // loads served by an older store
+    uint64_t blocked;       // cycles loads waited for older stores
+    uint64_t speculative;   // loads executed before an older store address was known
+    uint64_t held;          // loads held back by a predicted dependence
+    uint64_t violations;    // loads that read stale data
+    uint64_t false_deps;    // held loads that did not overlap their store
+
+    PerfStats()
+      : forwards(0)
+      , blocked(0)
+      , speculative(0)
+      , held(0)
+      , violations(0)
+      , false_deps(0)
+    {}
+  };
+
+  // outcome of a load disambiguation
+  enum {
+    LOAD_MEMORY,
+    LOAD_FORWARD,
+    LOAD_WAIT
+  };
+
+  LoadStoreQueue(uint32_t lq_size, uint32_t sq_size, uint32_t rob_size, bool speculative);
+
+  ~LoadStoreQueue();
+
+  void reset();
+
+  bool full(bool is_store) const {
+    return is_store ? (stores_.size() == sq_size_) : (loads_.size() == lq_size_);
+  }
+
+  // loads can be given the store they are predicted to depend on
+  void allocate(const Instr& instr, int rob_index, uint64_t wait = NO_STORE);
+
+  // check whether a load can execute, returns LOAD_*
+  int disambiguate(int rob_index, uint64_t addr, uint32_t size);
+
+  // record the address of an executing load, returns LOAD_MEMORY or
+  // LOAD_FORWARD with the forwarded data right-aligned in *data.
+  int execute_load(int rob_index, uint64_t addr, uint32_t size, uint32_t* data);
+
+  // record the address and data of an executing store, returns the ROB
+  // index of the oldest younger load that read stale data, or -1.
+  int execute_store(int rob_index, uint64_t addr, uint32_t size, uint32_t data);
+
+  // oldest store, written to memory at commit
+  const entry_t& store_head() const {
+    return stores_.front();
+  }
+
+  void commit(bool is_store);
+
+  // drop the entries of squashed instructions,
+  // and the squashed stores the predictor still holds loads for
+  void squash(const ReorderBuffer& ROB, StoreSetPredictor& store_sets);
+
+  PerfStats& perf_stats() {
+    return perf_stats_;
+  }
+
+private:
+
+  entry_t* find(bool is_store, int rob_index);
+
+  // search the older stores for the data of a load, returns LOAD_*
+  int search(const entry_t& load, uint64_t addr, uint32_t size, const entry_t** store) const;
+
+  // entries are numbered in allocation order since reset,
+  // which locates them from their ROB index without a search
+  std::deque<entry_t> loads_;
+  std::deque<entry_t> stores_;
+  std::vector<uint64_t> seqs_;  // by ROB index
+  uint64_t load_base_;          // number of the oldest load
+  uint64_t store_base_;         // number of the oldest store
+  uint32_t lq_size_;
+  uint32_t sq_size_;
+  bool speculative_;
+  PerfStats perf_stats_;
+};
+
+}
@@ -0,0 +1,113 @@
+// Copyright 2024 blaise
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <vector>
+#include <deque>
+
+namespace tinyrv {
+
+// merged physical register file
+// holds both the committed and the speculative register values,
+// with a ready bit per register and a free list of unmapped registers.
+// eliminated moves share a register, which is reference counted by its
+// architectural mappings and in-flight destinations.
+class PhysicalRegisterFile {
+public:
+  PhysicalRegisterFile(uint32_t size)
+    : values_(size)
+    , ready_(size)
+    , refs_(size)
+  {}
+
+  ~PhysicalRegisterFile() {}
+
+  // map the first num_regs registers to the architectural registers
+  void reset(uint32_t num_regs) {
+    assert(num_regs < values_.size());
+    free_list_.clear();
+    for (uint32_t i = 0; i < values_.size(); ++i) {
+      values_[i] = 0;
+      ready_[i] = true;
+      refs_[i] = (i < num_regs) ? 1 : 0;
+      if (i >= num_regs) {
+        free_list_.push_back(i);
+      }
+    }
+  }
+
+  bool empty() const {
+    return free_list_.empty();
+  }
+
+  uint32_t size() const {
+    return values_.size();
+  }
+
+  int allocate() {
+    assert(!free_list_.empty());
+    int index = free_list_.front();
+    free_list_.pop_front();
+    ready_[index] = false;
+    refs_[index] = 1;
+    return index;
+  }
+
+  // map one more register to index
+  void share(int index) {
+    assert(refs_.at(index) != 0);
+    ++refs_[index];
+  }
+
+  void release(int index) {
+    assert(refs_.at(index) != 0);
+    if (--refs_[index] == 0) {
+      free_list_.push_back(index);
+    }
+  }
+
+  // reset the reference counts, the unreferenced registers are free
+  void rebuild(const std::vector<uint32_t>& refs) {
+    free_list_.clear();
+    for (uint32_t i = 0; i < values_.size(); ++i) {
+      refs_[i] = refs.at(i);
+      if (refs_[i] == 0) {
+        free_list_.push_back(i);
+      }
+    }
+  }
+
+  bool ready(int index) const {
+    return ready_.at(index);
+  }
+
+  uint32_t read(int index) const {
+    assert(ready_.at(index));
+    return values_[index];
+  }
+
+  void write(int index, uint32_t value) {
+    values_.at(index) = value;
+    ready_[index] = true;
+  }
+
+private:
+  std::vector<uint32_t> values_;
+  std::vector<bool>     ready_;
+  std::vector<uint32_t> refs_;
+  std::deque<int>       free_list_;
+};
+
+}
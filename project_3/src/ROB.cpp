@@ -22,15 +22,13 @@ using namespace tinyrv;
 
 ReorderBuffer::ReorderBuffer(uint32_t size)
   : store_(size)
+  , valid_((size + 63) / 64, 0)
+  , ready_((size + 63) / 64, 0)
+  , branches_((size + 63) / 64, 0)
   , head_index_(0)
   , tail_index_(0)
   , count_(0)
-{
-  for (auto& entry : store_) {
-    entry.valid = false;
-    entry.ready = false;
-  }
-}
+{}
 
 ReorderBuffer::~ReorderBuffer() {
   //--
@@ -39,7 +37,10 @@ ReorderBuffer::~ReorderBuffer() {
 int ReorderBuffer::allocate(Instr::Ptr instr) {
   assert(!this->full());
   int index = tail_index_;
-  store_[index] = {true, false, 0, instr};
+  store_[index] = {0, instr, -1, -1};
+  set_bit(valid_, index, true);
+  set_bit(ready_, index, false);
+  set_bit(branches_, index, instr->getBrOp() != BrOp::NONE);
   tail_index_ = (tail_index_ + 1) % store_.size();
   ++count_;
   return index;
@@ -47,13 +48,14 @@ int ReorderBuffer::allocate(Instr::Ptr instr) {
 
 void ReorderBuffer::update(const CommonDataBus::data_t& data) {
   auto& entry = store_[data.rob_index];
-  assert(entry.valid);
-  assert(!entry.ready);
+  assert(test_bit(valid_, data.rob_index));
+  assert(!test_bit(ready_, data.rob_index));
 
   // Udate the ROB entry
   // TODO:
-  entry.ready = true; 
+  set_bit(ready_, data.rob_index, true); 
   entry.result = data.result; 
+  set_bit(branches_, data.rob_index, false);
 
   if (entry.instr->getExeFlags().use_rd) {
     DT(2, "Writeback: value=0x" << std::hex << data.result << std::dec << ", " << *entry.instr);
@@ -62,22 +64,60 @@ void ReorderBuffer::update(const CommonDataBus::data_t& data) {
   }
 }
 
+void ReorderBuffer::complete(int index) {
+  assert(test_bit(valid_, index));
+  assert(!test_bit(ready_, index));
+  set_bit(ready_, index, true);
+  set_bit(branches_, index, false);
+  DT(2, "Writeback: " << *store_[index].instr);
+}
+
 int ReorderBuffer::pop() {
   assert(!this->empty());
-  assert(store_[head_index_].valid);
-  assert(store_[head_index_].ready);
-  store_[head_index_].valid = false;
-  store_[head_index_].ready = false;
+  assert(test_bit(valid_, head_index_));
+  assert(test_bit(ready_, head_index_));
+  set_bit(valid_, head_index_, false);
+  set_bit(ready_, head_index_, false);
   head_index_ = (head_index_ + 1) % store_.size();
   --count_;
   return head_index_;
 }
 
+uint32_t ReorderBuffer::squash(int index) {
+  assert(test_bit(valid_, index));
+  int tail_index = (index + 1) % store_.size();
+  uint32_t count = 0;
+  while (tail_index_ != tail_index) {
+    tail_index_ = (tail_index_ + store_.size() - 1) % store_.size();
+    assert(test_bit(valid_, tail_index_));
+    DT(2, "Squash: " << *store_[tail_index_].instr);
+    set_bit(valid_, tail_index_, false);
+    set_bit(ready_, tail_index_, false);
+    set_bit(branches_, tail_index_, false);
+    store_[tail_index_].instr = nullptr;
+    --count_;
+    ++count;
+  }
+  return count;
+}
+
+uint32_t ReorderBuffer::resolved_count() const {
+  // scan the branch bits from the head, a word at a time
+  uint32_t size = store_.size();
+  for (uint32_t i = 0; i < count_;) {
+    uint32_t index = (head_index_ + i) % size;
+    uint64_t word = branches_[index / 64] >> (index % 64);
+    if (word)
+      return std::min(i + count_trailing_zeros64(word), count_);
+    i += std::min(64 - index % 64, size - index);
+  }
+  return count_;
+}
+
 void ReorderBuffer::dump() {
   for (int i = 0; i < (int)store_.size(); ++i) {
-    auto& entry = store_[i];
-    if (entry.valid) {
-      DT(4, "ROB[" << i << "] ready=" << entry.ready << ", head=" << (i == head_index_) << " (#" << entry.instr->getId() << ")");
+    if (test_bit(valid_, i)) {
+      DT(4, "ROB[" << i << "] ready=" << test_bit(ready_, i) << ", head=" << (i == head_index_) << " (#" << store_[i].instr->getId() << ")");
     }
   }
 }
\ No newline at end of file
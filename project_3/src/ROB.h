@@ -14,19 +14,24 @@
 #pragma once
 
 #include <vector>
+#include <assert.h>
 #include "instr.h"
 #include "CDB.h"
 
 namespace tinyrv {
 
+// Reorder buffer.
+// The valid and ready flags and the unresolved branches are kept in packed
+// arrays apart from the entries, so that the per-cycle checks and scans
+// do not touch the instruction data.
 class ReorderBuffer {
 public:
 
   struct rob_entry_t {
-    bool       valid;   // valid entry
-    bool       ready;   // completed
     uint32_t   result;  // result data
     Instr::Ptr instr;   // instruction data
+    int        pdst;    // physical destination register (RENAME_PRF), or -1
+    int        old_pdst;// its previous mapping, freed at commit
   };
 
   ReorderBuffer( uint32_t size);
@@ -45,12 +50,51 @@ public:
 
   int pop();
 
+  // drop the entries younger than index, return their count
+  uint32_t squash(int index);
+
   void update(const CommonDataBus::data_t& data);
 
+  // mark an entry completed, its result went to the physical register file
+  void complete(int index);
+
+  // valid entry
+  bool valid(int index) const {
+    assert(index >= 0 && index < (int)store_.size());
+    return test_bit(valid_, index);
+  }
+
+  // completed entry
+  bool ready(int index) const {
+    assert(index >= 0 && index < (int)store_.size());
+    return test_bit(ready_, index);
+  }
+
+  // distance from the head of the oldest unresolved branch, or count()
+  uint32_t resolved_count() const;
+
   int head_index() const {
     return head_index_;
   }
 
+  // entry allocated just before index
+  int prev_index(int index) const {
+    return (index + store_.size() - 1) % store_.size();
+  }
+
+  uint32_t size() const {
+    return store_.size();
+  }
+
+  uint32_t count() const {
+    return count_;
+  }
+
+  // distance of an entry from the head, older entries are closer
+  uint32_t age(int index) const {
+    return (index - head_index_ + store_.size()) % store_.size();
+  }
+
   const rob_entry_t& get_entry(int index) const {
     return store_.at(index);
   }
@@ -63,7 +107,23 @@ public:
 
 private:
 
+  static bool test_bit(const std::vector<uint64_t>& words, int index) {
+    return (words[index / 64] >> (index % 64)) & 1;
+  }
+
+  static void set_bit(std::vector<uint64_t>& words, int index, bool value) {
+    uint64_t bit = 1ull << (index % 64);
+    if (value) {
+      words[index / 64] |= bit;
+    } else {
+      words[index / 64] &= ~bit;
+    }
+  }
+
   std::vector<rob_entry_t> store_;
+  std::vector<uint64_t> valid_;     // one bit per entry
+  std::vector<uint64_t> ready_;
+  std::vector<uint64_t> branches_;  // unresolved branch entries
   int head_index_;
   int tail_index_;
   uint32_t count_;
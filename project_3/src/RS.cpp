@@ -22,10 +22,17 @@ using namespace tinyrv;
 
 ReservationStation::ReservationStation(uint32_t size)
   : store_(size)
+  , rob_indices_(size, -1)
+  , rs1_indices_(size, -1)
+  , rs2_indices_(size, -1)
   , indices_(size)
-  , next_index_(0) {
+  , next_index_(0)
+  , valid_(size)
+  , running_(size)
+  , ready_(size)
+  , waiters_(size)
+  , older_(size) {
   for (uint32_t i = 0; i < size; ++i) {
-    store_[i].valid = false;
     indices_[i] = i;
   }
 }
@@ -35,30 +42,96 @@ ReservationStation::~ReservationStation() {}
 int ReservationStation::issue(int rob_index, int rs1_index, int rs2_index, uint32_t rs1_data, uint32_t rs2_data, Instr::Ptr instr) {
     assert(!this->full());
     int index = indices_[next_index_++];
-    uint32_t barrier_id = 0;
-    if (instr->getFUType() == FUType::LSU) {
-      barrier_id = lsu_barrier_.tick();
-    }
-    store_[index] = {true, false, rob_index, rs1_index, rs2_index, rs1_data, rs2_data, barrier_id, instr};
+    store_[index] = {rs1_data, rs2_data, instr};
+    rob_indices_[index] = rob_index;
+    rs1_indices_[index] = rs1_index;
+    rs2_indices_[index] = rs2_index;
     assert(index != rs1_index);
     assert(index != rs2_index);
+
+    // every valid entry is older
+    older_.assign_row(index, valid_);
+    valid_.set(index);
+    if (rs1_index != -1) {
+      waiters_.set(rs1_index, index);
+    }
+    if (rs2_index != -1) {
+      waiters_.set(rs2_index, index);
+    }
+    if (this->operands_ready(index)) {
+      ready_.set(index);
+    }
     return index;
   }
 
+  void ReservationStation::wakeup(const CommonDataBus::data_t& data) {
+    int producer = data.rs_index;
+    for (int i = waiters_.row_next(producer, 0); i != -1; i = waiters_.row_next(producer, i + 1)) {
+      // update operands if this RS entry is waiting for them
+      // TODO:
+      auto& entry = store_[i];
+      if (rs1_indices_[i] == producer) {
+        rs1_indices_[i] = -1;
+        entry.rs1_data = data.result;
+      }
+      if (rs2_indices_[i] == producer) {
+        rs2_indices_[i] = -1;
+        entry.rs2_data = data.result;
+      }
+      if (this->operands_ready(i)) {
+        ready_.set(i);
+      }
+    }
+    waiters_.clear_row(producer);
+  }
+
+  int ReservationStation::select(const Mask& candidates, bool oldest) const {
+    for (int i = candidates.next(0); i != -1; i = candidates.next(i + 1)) {
+      if (!oldest || !older_.row_intersects(i, candidates))
+        return i;
+    }
+    return -1;
+  }
+
+  void ReservationStation::dispatch(uint32_t index) {
+    assert(valid_.test(index) && !running_.test(index));
+    running_.set(index);
+    ready_.reset(index);
+  }
+
+  void ReservationStation::replay(uint32_t index) {
+    assert(valid_.test(index) && running_.test(index));
+    running_.reset(index);
+    if (this->operands_ready(index)) {
+      ready_.set(index);
+    }
+  }
+
+  void ReservationStation::waiting_on(uint32_t producer, Mask* mask) const {
+    for (int i = waiters_.row_next(producer, 0); i != -1; i = waiters_.row_next(producer, i + 1)) {
+      if (!running_.test(i)
+       && (rs1_indices_[i] == -1 || rs1_indices_[i] == (int)producer)
+       && (rs2_indices_[i] == -1 || rs2_indices_[i] == (int)producer)) {
+        mask->set(i);
+      }
+    }
+  }
+
   void ReservationStation::release(uint32_t index) {
     assert(!this->empty());
-    auto& entry = store_.at(index);
-    entry.valid = false;
-    entry.running = false;
-    if (entry.instr->getFUType() == FUType::LSU) {
-      lsu_barrier_.tock();
-    }
+    assert(valid_.test(index));
     indices_[--next_index_] = index;
-  }
 
-  bool ReservationStation::locked(uint32_t index) const {
-    auto& entry = store_.at(index);
-    if (!entry.valid || entry.instr->getFUType() != FUType::LSU)
-      return false;
-    return !lsu_barrier_.ready(entry.barrier_id);
+    // a squashed entry may still be waiting on its producers
+    if (rs1_indices_[index] != -1) {
+      waiters_.reset(rs1_indices_[index], index);
+    }
+    if (rs2_indices_[index] != -1) {
+      waiters_.reset(rs2_indices_[index], index);
+    }
+    waiters_.clear_row(index);
+    valid_.reset(index);
+    running_.reset(index);
+    ready_.reset(index);
+    older_.clear_column(index);
   }
@@ -13,51 +13,165 @@
 // limitations under the License.
 
 #include <vector>
+#include <algorithm>
 #include "instr.h"
 #include "CDB.h"
 
 namespace tinyrv {
 
+// Reservation stations.
+// Wakeup and select use bit masks over the entries, updated a word at a
+// time: a dependency matrix row per producer holds the entries waiting on
+// its result, and an age matrix row per entry holds the entries issued
+// before it, so that the oldest of a set of candidates has no older
+// candidate in its row. Each matrix is stored as one array of rows.
+// The entry state used by wakeup and select (valid and running bits, ROB
+// index and producers) is kept in its own arrays, apart from the operand
+// data and instruction that are only read at dispatch.
 class ReservationStation {
 public:
 
-  struct entry_t {
-    bool valid;       // valid entry
-    bool running;     // has been assigned an FU
-    int rob_index;    // allocated ROB index
-    int rs1_index;    // RS producing rs1 (-1 indicates data is already available)
-    int rs2_index;    // RS producing rs2 (-1 indicates data is already available)
-    uint32_t rs1_data; // rs1 data
-    uint32_t rs2_data; // rs2 data
-    uint32_t barrier_id; // barrier id to enforce ordering fo LSU instructions
-    Instr::Ptr instr; // instruction data
+  // set of RS entries
+  class Mask {
+  public:
+    Mask(uint32_t size = 0) : words_((size + 63) / 64, 0) {}
+
+    void set(uint32_t index) {
+      words_[index / 64] |= (1ull << (index % 64));
+    }
+
+    void reset(uint32_t index) {
+      words_[index / 64] &= ~(1ull << (index % 64));
+    }
+
+    bool test(uint32_t index) const {
+      return (words_[index / 64] >> (index % 64)) & 1;
+    }
+
+    void clear() {
+      std::fill(words_.begin(), words_.end(), 0);
+    }
+
+    bool any() const {
+      for (auto word : words_) {
+        if (word)
+          return true;
+      }
+      return false;
+    }
+
+    bool intersects(const Mask& other) const {
+      for (uint32_t i = 0; i < words_.size(); ++i) {
+        if (words_[i] & other.words_[i])
+          return true;
+      }
+      return false;
+    }
+
+    // lowest entry at or after index, or -1
+    int next(uint32_t index) const {
+      return Mask::next(words_.data(), words_.size(), index);
+    }
+
+    const uint64_t* data() const {
+      return words_.data();
+    }
+
+    static int next(const uint64_t* words, uint32_t num_words, uint32_t index) {
+      for (uint32_t w = index / 64; w < num_words; ++w) {
+        uint64_t word = words[w];
+        if (w == index / 64) {
+          word &= ~0ull << (index % 64);
+        }
+        if (word)
+          return w * 64 + count_trailing_zeros64(word);
+      }
+      return -1;
+    }
+
+  private:
+    std::vector<uint64_t> words_;
+  };
+
+  // square bit matrix with a Mask-sized row per entry
+  class Matrix {
+  public:
+    Matrix(uint32_t size)
+      : stride_((size + 63) / 64)
+      , words_(size * stride_, 0)
+    {}
+
+    void set(uint32_t row, uint32_t col) {
+      words_[row * stride_ + col / 64] |= (1ull << (col % 64));
+    }
+
+    void reset(uint32_t row, uint32_t col) {
+      words_[row * stride_ + col / 64] &= ~(1ull << (col % 64));
+    }
 
-    bool operands_ready() const {
-      return rs1_index == -1 && rs2_index == -1;
+    void assign_row(uint32_t row, const Mask& mask) {
+      std::copy(mask.data(), mask.data() + stride_, words_.begin() + row * stride_);
     }
 
-    void update_operands(const CommonDataBus::data_t& data) {
-      // update operands if this RS entry is waiting for them
-      // TODO:
-      if(rs1_index == data.rs_index){
-        rs1_index = -1; 
-        rs1_data = data.result; 
+    void clear_row(uint32_t row) {
+      std::fill(words_.begin() + row * stride_, words_.begin() + (row + 1) * stride_, 0);
+    }
+
+    void clear_column(uint32_t col) {
+      uint64_t keep = ~(1ull << (col % 64));
+      for (uint32_t w = col / 64; w < words_.size(); w += stride_) {
+        words_[w] &= keep;
       }
-      if(rs2_index == data.rs_index){
-        rs2_index = -1; 
-        rs2_data = data.result; 
+    }
+
+    bool row_intersects(uint32_t row, const Mask& mask) const {
+      auto words = &words_[row * stride_];
+      for (uint32_t i = 0; i < stride_; ++i) {
+        if (words[i] & mask.data()[i])
+          return true;
       }
+      return false;
     }
+
+    // lowest column at or after index set in row, or -1
+    int row_next(uint32_t row, uint32_t index) const {
+      return Mask::next(&words_[row * stride_], stride_, index);
+    }
+
+  private:
+    uint32_t stride_;
+    std::vector<uint64_t> words_;
+  };
+
+  struct entry_t {
+    uint32_t rs1_data; // rs1 data
+    uint32_t rs2_data; // rs2 data
+    Instr::Ptr instr; // instruction data
   };
 
   ReservationStation(uint32_t size);
 
   ~ReservationStation();
 
-  // bool operands_ready(uint32_t index) const {
-  //   // are all operands ready?
-  //   // TODO:
-  // }
+  bool operands_ready(uint32_t index) const {
+    // are all operands ready?
+    return rs1_indices_[index] == -1 && rs2_indices_[index] == -1;
+  }
+
+  // allocated ROB index
+  int rob_index(uint32_t index) const {
+    return rob_indices_.at(index);
+  }
+
+  // RS producing rs1 (-1 indicates data is already available)
+  int rs1_index(uint32_t index) const {
+    return rs1_indices_.at(index);
+  }
+
+  // RS producing rs2 (-1 indicates data is already available)
+  int rs2_index(uint32_t index) const {
+    return rs2_indices_.at(index);
+  }
 
   const entry_t& get_entry(uint32_t index) const {
     return store_.at(index);
@@ -69,9 +183,37 @@ public:
 
   int issue(int rob_index, int rs1_index, int rs2_index, uint32_t rs1_data, uint32_t rs2_data, Instr::Ptr instr);
 
-  void release(uint32_t index);
+  // forward a broadcast result to the entries waiting on its producer
+  void wakeup(const CommonDataBus::data_t& data);
+
+  // valid entries
+  const Mask& valid() const {
+    return valid_;
+  }
+
+  // entries that have been assigned an FU
+  const Mask& running() const {
+    return running_;
+  }
+
+  // entries with all their operands that were not dispatched yet
+  const Mask& ready() const {
+    return ready_;
+  }
+
+  // pick the lowest or the oldest of the candidates, or -1
+  int select(const Mask& candidates, bool oldest) const;
 
-  bool locked(uint32_t index) const;
+  void dispatch(uint32_t index);
+
+  // return a dispatched entry that ran without its operands,
+  // it keeps waiting on its producers
+  void replay(uint32_t index);
+
+  // add the entries that only wait on producer to mask
+  void waiting_on(uint32_t producer, Mask* mask) const;
+
+  void release(uint32_t index);
 
   bool full() const {
     return (next_index_ == store_.size());
@@ -87,9 +229,8 @@ public:
 
   void dump() {
     for (uint32_t i = 0; i < store_.size(); ++i) {
-      auto& entry = store_[i];
-      if (entry.valid) {
-        DT(4, "RS[" << i << "] rob=" << entry.rob_index << ", running=" << entry.running << ", rs1=" << entry.rs1_index << ", rs2=" << entry.rs2_index << " (#" << entry.instr->getId() << ")");
+      if (valid_.test(i)) {
+        DT(4, "RS[" << i << "] rob=" << rob_indices_[i] << ", running=" << running_.test(i) << ", rs1=" << rs1_indices_[i] << ", rs2=" << rs2_indices_[i] << " (#" << store_[i].instr->getId() << ")");
       }
     }
   }
@@ -97,11 +238,16 @@ public:
 private:
 
   std::vector<entry_t>  store_;
+  std::vector<int>      rob_indices_;
+  std::vector<int>      rs1_indices_;
+  std::vector<int>      rs2_indices_;
   std::vector<uint32_t> indices_;
   uint32_t next_index_;
-  uint32_t lsu_barrier_tick_;
-  uint32_t lsu_barrier_tock_;
-  TicketBarrier lsu_barrier_;
+  Mask valid_;
+  Mask running_;
+  Mask ready_;
+  Matrix waiters_;  // dependency matrix, by producer
+  Matrix older_;    // age matrix
 };
 
 }
\ No newline at end of file
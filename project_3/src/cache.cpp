@@ -0,0 +1,234 @@
+// Copyright 2024 Blaise Tine
+//
+// Licensed under the Apache License;
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <iostream>
+#include <iomanip>
+#include <assert.h>
+#include <util.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "types.h"
+#include "debug.h"
+#include "cache.h"
+
+using namespace tinyrv;
+
+Cache::Cache(const Config& config)
+  : config_(config)
+  , line_bits_(log2ceil(config.line_size))
+  , num_sets_(config.size / (config.line_size * config.ways))
+{
+  assert(ispow2(config.line_size));
+  assert(config.ways >= 1 && config.ways <= 64);
+  assert(num_sets_ >= 1 && ispow2(num_sets_));
+  assert(config.repl != CACHE_REPL_PLRU || ispow2(config.ways));
+  set_bits_ = log2ceil(num_sets_);
+  tags_.resize(num_sets_ * config.ways);
+  dirty_.resize(num_sets_);
+  if (config.repl == CACHE_REPL_LRU) {
+    repl_.resize(num_sets_ * config.ways);
+  } else if (config.repl == CACHE_REPL_PLRU) {
+    repl_.resize(num_sets_);
+  }
+  this->reset();
+}
+
+Cache::~Cache() {
+  //--
+}
+
+void Cache::reset() {
+  std::fill(tags_.begin(), tags_.end(), 0);
+  std::fill(dirty_.begin(), dirty_.end(), 0);
+  std::fill(repl_.begin(), repl_.end(), 0);
+  lru_clock_ = 0;
+  rand_state_ = 0x2545f491;
+  perf_stats_ = PerfStats();
+}
+
+int Cache::find_way(uint32_t set, uint32_t tag) const {
+  const uint32_t* tags = tags_.data() + set * config_.ways;
+  uint32_t key = (tag << 1) | 1;
+  uint32_t way = 0;
+#ifdef __SSE2__
+  // compare four ways at a time
+  __m128i vkey = _mm_set1_epi32(key);
+  for (; way + 4 <= config_.ways; way += 4) {
+    __m128i vtags = _mm_loadu_si128((const __m128i*)(tags + way));
+    int mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(vtags, vkey)));
+    if (mask)
+      return way + count_trailing_zeros(mask);
+  }
+#endif
+  for (; way < config_.ways; ++way) {
+    if (tags[way] == key)
+      return way;
+  }
+  return -1;
+}
+
+void Cache::touch(uint32_t set, uint32_t way) {
+  switch (config_.repl) {
+  case CACHE_REPL_LRU:
+    repl_[set * config_.ways + way] = ++lru_clock_;
+    break;
+  case CACHE_REPL_PLRU: {
+    // point every node on the path away from this way
+    uint64_t bits = repl_[set];
+    uint32_t node = 1;
+    for (uint32_t level = log2ceil(config_.ways); level != 0; --level) {
+      uint32_t dir = (way >> (level - 1)) & 1;
+      bits = dir ? bit_clr(bits, node) : bit_set(bits, node);
+      node = 2 * node + dir;
+    }
+    repl_[set] = bits;
+  } break;
+  default:
+    break;
+  }
+}
+
+int Cache::select_victim(uint32_t set) {
+  const uint32_t* tags = tags_.data() + set * config_.ways;
+
+  // use an invalid way first
+  for (uint32_t way = 0; way < config_.ways; ++way) {
+    if ((tags[way] & 1) == 0)
+      return way;
+  }
+
+  switch (config_.repl) {
+  case CACHE_REPL_LRU: {
+    const uint64_t* stamps = repl_.data() + set * config_.ways;
+    uint32_t victim = 0;
+    for (uint32_t way = 1; way < config_.ways; ++way) {
+      if (stamps[way] < stamps[victim]) {
+        victim = way;
+      }
+    }
+    return victim;
+  }
+  case CACHE_REPL_PLRU: {
+    uint64_t bits = repl_[set];
+    uint32_t node = 1;
+    while (node < config_.ways) {
+      node = 2 * node + bit_get(bits, node);
+    }
+    return node - config_.ways;
+  }
+  default: {
+    // xorshift32
+    rand_state_ ^= rand_state_ << 13;
+    rand_state_ ^= rand_state_ >> 17;
+    rand_state_ ^= rand_state_ << 5;
+    return rand_state_ % config_.ways;
+  }
+  }
+}
+
+bool Cache::access(uint64_t addr, bool is_write, uint64_t* wb_addr) {
+  uint64_t line = addr >> line_bits_;
+  uint32_t set  = line & (num_sets_ - 1);
+  uint32_t tag  = uint32_t(line >> set_bits_);
+
+  // a single access writes at most one line back
+  uint64_t writeback = NO_WRITEBACK;
+  if (wb_addr) {
+    *wb_addr = NO_WRITEBACK;
+  }
+
+  if (is_write) {
+    ++perf_stats_.writes;
+  } else {
+    ++perf_stats_.reads;
+  }
+
+  int way = this->find_way(set, tag);
+  if (way >= 0) {
+    this->touch(set, way);
+    if (is_write) {
+      if (config_.write_back) {
+        dirty_[set] = bit_set(dirty_[set], way);
+      } else {
+        ++perf_stats_.writebacks; // write-through
+        writeback = line;
+      }
+    }
+    if (wb_addr && writeback != NO_WRITEBACK) {
+      *wb_addr = writeback << line_bits_;
+    }
+    return true;
+  }
+
+  if (is_write) {
+    ++perf_stats_.write_misses;
+    if (!config_.write_allocate) {
+      ++perf_stats_.writebacks; // write around
+      if (wb_addr) {
+        *wb_addr = line << line_bits_;
+      }
+      return false;
+    }
+  } else {
+    ++perf_stats_.read_misses;
+  }
+
+  // allocate the missing line
+  way = this->select_victim(set);
+  uint32_t& entry = tags_[set * config_.ways + way];
+  if (entry & 1) {
+    ++perf_stats_.evictions;
+    if (bit_get(dirty_[set], way)) {
+      ++perf_stats_.writebacks;
+      writeback = (uint64_t(entry >> 1) << set_bits_) | set;
+    }
+  }
+  entry = (tag << 1) | 1;
+  dirty_[set] = bit_clr(dirty_[set], way);
+  if (is_write) {
+    if (config_.write_back) {
+      dirty_[set] = bit_set(dirty_[set], way);
+    } else {
+      ++perf_stats_.writebacks;
+      writeback = line;
+    }
+  }
+  this->touch(set, way);
+
+  if (wb_addr && writeback != NO_WRITEBACK) {
+    *wb_addr = writeback << line_bits_;
+  }
+
+  DT(3, config_.name << " miss: addr=0x" << std::hex << addr << std::dec << ", set=" << set << ", way=" << way);
+
+  return false;
+}
+
+void Cache::showStats() const {
+  uint64_t accesses = perf_stats_.reads + perf_stats_.writes;
+  uint64_t misses = perf_stats_.read_misses + perf_stats_.write_misses;
+  std::cout << std::dec << "PERF: " << config_.name
+            << ": reads=" << perf_stats_.reads
+            << ", writes=" << perf_stats_.writes
+            << ", read misses=" << perf_stats_.read_misses
+            << ", write misses=" << perf_stats_.write_misses
+            << ", evictions=" << perf_stats_.evictions
+            << ", writebacks=" << perf_stats_.writebacks;
+  if (accesses != 0) {
+    std::cout << ", hit rate=" << std::fixed << std::setprecision(2)
+              << (100.0 * (accesses - misses) / accesses) << "%";
+    std::cout.unsetf(std::ios::floatfield);
+  }
+  std::cout << std::endl;
+}
@@ -0,0 +1,116 @@
+// Copyright 2024 Blaise Tine
+//
+// Licensed under the Apache License;
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <vector>
+#include <iostream>
+#include "types.h"
+
+namespace tinyrv {
+
+// Set-associative cache timing model.
+// Only tags are tracked, data is always accessed through the MemoryUnit.
+class Cache {
+public:
+  struct Config {
+    const char* name;
+    uint32_t size;          // capacity in bytes
+    uint32_t ways;          // associativity
+    uint32_t line_size;     // line size in bytes
+    uint32_t repl;          // replacement policy (CACHE_REPL_*)
+    bool     write_back;    // write-back (else write-through)
+    bool     write_allocate;// allocate on write miss
+    uint32_t hit_latency;   // hit latency in cycles
+    uint32_t miss_latency;  // additional miss penalty in cycles
+  };
+
+  struct PerfStats {
+    uint64_t reads;
+    uint64_t writes;
+    uint64_t read_misses;
+    uint64_t write_misses;
+    uint64_t evictions;
+    uint64_t writebacks;
+
+    PerfStats()
+      : reads(0)
+      , writes(0)
+      , read_misses(0)
+      , write_misses(0)
+      , evictions(0)
+      , writebacks(0)
+    {}
+  };
+
+  Cache(const Config& config);
+
+  ~Cache();
+
+  void reset();
+
+  // access the cache and update its state, return true on hit.
+  // when the access sends a line back to memory, its address is
+  // returned in wb_addr, which is otherwise set to NO_WRITEBACK.
+  bool access(uint64_t addr, bool is_write, uint64_t* wb_addr = nullptr);
+
+  static constexpr uint64_t NO_WRITEBACK = uint64_t(-1);
+
+  // check whether the line holding addr is present, without updating state
+  bool contains(uint64_t addr) const {
+    uint64_t line = addr >> line_bits_;
+    return this->find_way(line & (num_sets_ - 1), uint32_t(line >> set_bits_)) != -1;
+  }
+
+  // return the latency of an access with the given outcome
+  uint32_t latency(bool hit) const {
+    return hit ? config_.hit_latency : (config_.hit_latency + config_.miss_latency);
+  }
+
+  uint64_t line_addr(uint64_t addr) const {
+    return addr >> line_bits_;
+  }
+
+  const Config& config() const {
+    return config_;
+  }
+
+  const PerfStats& perf_stats() const {
+    return perf_stats_;
+  }
+
+  void showStats() const;
+
+private:
+
+  int  find_way(uint32_t set, uint32_t tag) const;
+  int  select_victim(uint32_t set);
+  void touch(uint32_t set, uint32_t way);
+
+  Config   config_;
+  uint32_t line_bits_;
+  uint32_t set_bits_;
+  uint32_t num_sets_;
+
+  // tags are stored per set as (tag << 1) | valid, so that a single
+  // comparison against (tag << 1) | 1 checks both the tag and the valid bit.
+  std::vector<uint32_t> tags_;
+  std::vector<uint64_t> dirty_;   // per-set dirty mask
+  std::vector<uint64_t> repl_;    // LRU timestamps, or per-set PLRU tree bits
+  uint64_t lru_clock_;
+  uint32_t rand_state_;
+
+  PerfStats perf_stats_;
+};
+
+}
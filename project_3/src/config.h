@@ -15,21 +15,319 @@
 
 #define XLEN 32
 
-#define NUM_FUS 4
+// functional unit pool: units of each type, the select logic
+// dispatches an instruction to any free unit of its type
+#ifndef NUM_ALUS
+#define NUM_ALUS 1
+#endif
+
+#ifndef NUM_BRUS
+#define NUM_BRUS 1
+#endif
+
+// load/store pipes, they share one LSU queue and its MSHRs
+#ifndef NUM_LSUS
+#define NUM_LSUS 1
+#endif
 
+#ifndef NUM_SFUS
+#define NUM_SFUS 1
+#endif
+
+#define NUM_FUS (NUM_ALUS + NUM_BRUS + 1 + NUM_SFUS)
+
+#ifndef ALU_LATENCY
 #define ALU_LATENCY 2
+#endif
+
+#ifndef BRU_LATENCY
 #define BRU_LATENCY 2
+#endif
+
+#ifndef LSU_LATENCY
 #define LSU_LATENCY 50
+#endif
+
+#ifndef SFU_LATENCY
 #define SFU_LATENCY 3
+#endif
+
+// initiation intervals: cycles between two operations entering a unit,
+// below the latency the unit is pipelined
+#ifndef ALU_INTERVAL
+#define ALU_INTERVAL ALU_LATENCY
+#endif
+
+#ifndef BRU_INTERVAL
+#define BRU_INTERVAL BRU_LATENCY
+#endif
+
+#ifndef SFU_INTERVAL
+#define SFU_INTERVAL SFU_LATENCY
+#endif
 
 #define CDB_LATENCY 2
 
+// CDB arbitration policies
+#define CDB_ARB_FU_PRIORITY 0   // fixed functional unit order
+#define CDB_ARB_OLDEST      1   // oldest ROB entry first
+#define CDB_ARB_ROUND_ROBIN 2   // rotate over the functional units
+
+// results broadcast per cycle
+#ifndef NUM_CDBS
+#define NUM_CDBS 1
+#endif
+
+#ifndef CDB_ARBITRATION
+#define CDB_ARBITRATION CDB_ARB_FU_PRIORITY
+#endif
+
+#ifndef LSU_MSHRS
+#define LSU_MSHRS 4
+#endif
+
+#ifndef LSU_QUEUE_SIZE
+#define LSU_QUEUE_SIZE 8
+#endif
+
+// load and store queue entries
+#ifndef LQ_SIZE
+#define LQ_SIZE 8
+#endif
+
+#ifndef SQ_SIZE
+#define SQ_SIZE 8
+#endif
+
+// memory dependence policies
+#define MEM_DEP_CONSERVATIVE 0  // loads wait for all older store addresses
+#define MEM_DEP_BLIND        1  // loads always speculate past unknown stores
+#define MEM_DEP_STORE_SET    2  // loads wait for their predicted store set
+
+#ifndef MEM_DEP_POLICY
+#define MEM_DEP_POLICY MEM_DEP_CONSERVATIVE
+#endif
+
+// store set predictor tables
+#ifndef SSIT_SIZE
+#define SSIT_SIZE 1024
+#endif
+
+#ifndef LFST_SIZE
+#define LFST_SIZE 128
+#endif
+
+#ifndef NUM_RSS
 #define NUM_RSS 8
+#endif
+
+// reservation station select order
+#define RS_SELECT_INDEX  0  // lowest entry first
+#define RS_SELECT_OLDEST 1  // oldest entry first
+
+#ifndef RS_SELECT
+#define RS_SELECT RS_SELECT_INDEX
+#endif
+
+// GShare branch predictor (-g)
+#ifndef BTB_SIZE
+#define BTB_SIZE 256
+#endif
+
+#ifndef BHR_SIZE
+#define BHR_SIZE 8
+#endif
+
+// instructions fetched, decoded and issued per cycle
+#ifndef ISSUE_WIDTH
+#define ISSUE_WIDTH 1
+#endif
+
+// fetch groups buffered between fetch and decode
+#ifndef FETCH_QUEUE_SIZE
+#define FETCH_QUEUE_SIZE 1
+#endif
+
+// decoded groups buffered between decode and issue
+#ifndef DECODE_BUFFER_SIZE
+#define DECODE_BUFFER_SIZE 1
+#endif
+
+// fuse LUI/AUIPC+ADDI, AUIPC+JALR, SLLI+SRLI and SLT+BEQ/BNE pairs of a fetch group at decode
+#ifndef MACRO_FUSION
+#define MACRO_FUSION 0
+#endif
 
+// complete register moves and zero/constant idioms at rename
+#ifndef MOVE_ELIMINATION
+#define MOVE_ELIMINATION 0
+#endif
+
+// wake up consumers in the cycle their producer completes, and the
+// consumers of loads when a hit would complete, replaying them on a miss
+#ifndef SPECULATIVE_WAKEUP
+#define SPECULATIVE_WAKEUP 0
+#endif
+
+// ROB entries retired per cycle
+#ifndef COMMIT_WIDTH
+#define COMMIT_WIDTH 1
+#endif
+
+#ifndef ROB_SIZE
 #define ROB_SIZE 16
+#endif
 
 #define NUM_REGS 32
 
+// register renaming schemes
+#define RENAME_ROB 0  // RAT maps to ROB entries, results are copied to the register file at commit
+#define RENAME_PRF 1  // RAT maps to a merged physical register file with a free list
+
+#ifndef RENAME_SCHEME
+#define RENAME_SCHEME RENAME_ROB
+#endif
+
+#ifndef NUM_PREGS
+#define NUM_PREGS 64
+#endif
+
+// L1 caches //////////////////////////////////////////////////////////////////
+
+// replacement policies
+#define CACHE_REPL_LRU    0
+#define CACHE_REPL_PLRU   1
+#define CACHE_REPL_RANDOM 2
+
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE MEM_BLOCK_SIZE
+#endif
+
+#ifndef ICACHE_ENABLED
+#define ICACHE_ENABLED 1
+#endif
+
+#ifndef ICACHE_SIZE
+#define ICACHE_SIZE 4096
+#endif
+
+#ifndef ICACHE_WAYS
+#define ICACHE_WAYS 2
+#endif
+
+#ifndef ICACHE_REPL
+#define ICACHE_REPL CACHE_REPL_LRU
+#endif
+
+#ifndef ICACHE_HIT_LATENCY
+#define ICACHE_HIT_LATENCY 1
+#endif
+
+#ifndef ICACHE_MISS_LATENCY
+#define ICACHE_MISS_LATENCY LSU_LATENCY
+#endif
+
+#ifndef DCACHE_ENABLED
+#define DCACHE_ENABLED 1
+#endif
+
+#ifndef DCACHE_SIZE
+#define DCACHE_SIZE 8192
+#endif
+
+#ifndef DCACHE_WAYS
+#define DCACHE_WAYS 4
+#endif
+
+#ifndef DCACHE_REPL
+#define DCACHE_REPL CACHE_REPL_LRU
+#endif
+
+#ifndef DCACHE_WRITE_BACK
+#define DCACHE_WRITE_BACK 1
+#endif
+
+#ifndef DCACHE_WRITE_ALLOCATE
+#define DCACHE_WRITE_ALLOCATE 1
+#endif
+
+#ifndef DCACHE_HIT_LATENCY
+#define DCACHE_HIT_LATENCY 2
+#endif
+
+#ifndef DCACHE_MISS_LATENCY
+#define DCACHE_MISS_LATENCY LSU_LATENCY
+#endif
+
+// TLBs, used once satp enables Sv32 translation.
+// L1 TLB lookups overlap the cache access, L2 TLB hits add L2TLB_LATENCY,
+// and page table walks read their entries through the data cache.
+#ifndef ITLB_SIZE
+#define ITLB_SIZE 16
+#endif
+
+#ifndef ITLB_WAYS
+#define ITLB_WAYS 4
+#endif
+
+#ifndef DTLB_SIZE
+#define DTLB_SIZE 16
+#endif
+
+#ifndef DTLB_WAYS
+#define DTLB_WAYS 4
+#endif
+
+#ifndef L2TLB_SIZE
+#define L2TLB_SIZE 128
+#endif
+
+#ifndef L2TLB_WAYS
+#define L2TLB_WAYS 4
+#endif
+
+#ifndef L2TLB_LATENCY
+#define L2TLB_LATENCY 4
+#endif
+
+// prefetch modes
+#define PREFETCH_NONE       0
+#define PREFETCH_NEXT_LINE  1
+#define PREFETCH_STRIDE     2
+#define PREFETCH_STREAM     3
+
+// data prefetcher in front of the data cache
+#ifndef PREFETCH_MODE
+#define PREFETCH_MODE PREFETCH_NONE
+#endif
+
+// lines prefetched ahead of the demand stream
+#ifndef PREFETCH_DEGREE
+#define PREFETCH_DEGREE 2
+#endif
+
+#ifndef PREFETCH_BUFFER_SIZE
+#define PREFETCH_BUFFER_SIZE 8
+#endif
+
+// PC-indexed stride table entries
+#ifndef PREFETCH_TABLE_SIZE
+#define PREFETCH_TABLE_SIZE 64
+#endif
+
+#ifndef PREFETCH_STREAMS
+#define PREFETCH_STREAMS 4
+#endif
+
+// largest cache size and set count covered by the miss-ratio curves (-m)
+#ifndef MRC_MAX_SIZE
+#define MRC_MAX_SIZE (1024 * 1024)
+#endif
+
+#ifndef MRC_MAX_SETS
+#define MRC_MAX_SETS 1024
+#endif
+
 #ifndef DEBUG_LEVEL
 #define DEBUG_LEVEL 3
 #endif
@@ -50,6 +348,53 @@
 #define MEM_BLOCK_SIZE 64
 #endif
 
+// memory requests the core issues per cycle,
+// fetch and LSU requests are arbitrated round-robin
+#ifndef MEM_PORT_WIDTH
+#define MEM_PORT_WIDTH 1
+#endif
+
+// DRAM //////////////////////////////////////////////////////////////////////
+
+// page policies
+#define DRAM_PAGE_OPEN    0
+#define DRAM_PAGE_CLOSED  1
+
+// cache misses are served by the DRAM model,
+// otherwise by the fixed ICACHE/DCACHE_MISS_LATENCY
+#ifndef DRAM_ENABLED
+#define DRAM_ENABLED 1
+#endif
+
+#ifndef DRAM_ROW_SIZE
+#define DRAM_ROW_SIZE 2048
+#endif
+
+#ifndef DRAM_PAGE_POLICY
+#define DRAM_PAGE_POLICY DRAM_PAGE_OPEN
+#endif
+
+#ifndef DRAM_QUEUE_SIZE
+#define DRAM_QUEUE_SIZE 16
+#endif
+
+// timings in DRAM cycles, scaled by MEM_CYCLE_RATIO core cycles when positive
+#ifndef DRAM_tRCD
+#define DRAM_tRCD 14
+#endif
+
+#ifndef DRAM_tCAS
+#define DRAM_tCAS 14
+#endif
+
+#ifndef DRAM_tRP
+#define DRAM_tRP 14
+#endif
+
+#ifndef DRAM_tBURST
+#define DRAM_tBURST 4
+#endif
+
 #ifndef MEM_ADDR_WIDTH
 #ifdef XLEN_64
 #define MEM_ADDR_WIDTH 48
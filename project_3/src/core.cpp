@@ -25,23 +25,58 @@ using namespace tinyrv;
 
 Core::Core(const SimContext& ctx, uint32_t core_id, ProcessorImpl* processor)
     : SimObject(ctx, "core")
+    , mem_req_port(this)
+    , mem_rsp_port(this)
     , core_id_(core_id)
     , processor_(processor)
+    , mmu_(0, MemoryUnit::TLBConfig(ITLB_SIZE / ITLB_WAYS, ITLB_WAYS,
+                                    DTLB_SIZE / DTLB_WAYS, DTLB_WAYS,
+                                    L2TLB_SIZE / L2TLB_WAYS, L2TLB_WAYS))
     , reg_file_(NUM_REGS)
-    , decode_queue_(FiFoReg<id_data_t>::Create("idq"))
-    , issue_queue_(FiFoReg<is_data_t>::Create("isq"))
+    , startup_addr_(STARTUP_ADDR)
+    , decode_queue_(FiFoReg<std::vector<id_data_t>>::Create("idq", FETCH_QUEUE_SIZE))
+    , issue_queue_(FiFoReg<std::vector<is_data_t>>::Create("isq", DECODE_BUFFER_SIZE))
     , fetch_stalled_(ValReg<bool>::Create("fetch_stalled", false))
+    , icache_({"icache", ICACHE_SIZE, ICACHE_WAYS, CACHE_LINE_SIZE, ICACHE_REPL,
+               false, false, ICACHE_HIT_LATENCY, ICACHE_MISS_LATENCY})
+    , dcache_({"dcache", DCACHE_SIZE, DCACHE_WAYS, CACHE_LINE_SIZE, DCACHE_REPL,
+               DCACHE_WRITE_BACK, DCACHE_WRITE_ALLOCATE, DCACHE_HIT_LATENCY, DCACHE_MISS_LATENCY})
+    , prefetcher_({PREFETCH_MODE, CACHE_LINE_SIZE, PREFETCH_DEGREE, PREFETCH_BUFFER_SIZE,
+                   PREFETCH_TABLE_SIZE, PREFETCH_STREAMS})
     , ROB_(ROB_SIZE)
     , RAT_(NUM_REGS)
     , RS_(NUM_RSS)
-    , RST_(NUM_REGS)
-    , FUs_(NUM_FUS)
+    , RST_((RENAME_SCHEME == RENAME_PRF) ? NUM_PREGS : ROB_SIZE)
+    , PRF_(NUM_PREGS)
+    , arch_RAT_(NUM_REGS)
+    , CDB_(NUM_CDBS)
+    , LSQ_(LQ_SIZE, SQ_SIZE, ROB_SIZE, MEM_DEP_POLICY != MEM_DEP_CONSERVATIVE)
+    , store_sets_(SSIT_SIZE, LFST_SIZE)
+    , symbols_(nullptr)
 {
-  // create functional units
-  FUs_.at((int)FUType::ALU) = std::make_shared<ALU>(this);
-  FUs_.at((int)FUType::LSU) = std::make_shared<LSU>(this);
-  FUs_.at((int)FUType::BRU) = std::make_shared<BRU>(this);
-  FUs_.at((int)FUType::SFU) = std::make_shared<SFU>(this);
+  // fetch takes the first memory port, the LSU attaches its own
+  icache_port_ = this->mem_attach("fetch", [this](uint32_t) {
+    icache_pending_ = false;
+  });
+
+  // create the functional unit pool, grouped by type in FUType order
+  fu_base_.push_back(FUs_.size());
+  for (uint32_t i = 0; i < NUM_ALUS; ++i) {
+    FUs_.push_back(std::make_shared<ALU>(this));
+  }
+  fu_base_.push_back(FUs_.size());
+  for (uint32_t i = 0; i < NUM_BRUS; ++i) {
+    FUs_.push_back(std::make_shared<BRU>(this));
+  }
+  fu_base_.push_back(FUs_.size());
+  lsu_ = std::make_shared<LSU>(this);
+  FUs_.push_back(lsu_);
+  fu_base_.push_back(FUs_.size());
+  for (uint32_t i = 0; i < NUM_SFUS; ++i) {
+    FUs_.push_back(std::make_shared<SFU>(this));
+  }
+  fu_base_.push_back(FUs_.size());
+  assert(FUs_.size() == NUM_FUS);
 
   // initialize register file at x0
   reg_file_.at(0) = 0;
@@ -54,19 +89,59 @@ Core::~Core() {}
 void Core::reset() {
   decode_queue_->reset();
   issue_queue_->reset();
+  issue_index_ = 0;
 
-  PC_ = STARTUP_ADDR;
+  PC_ = startup_addr_;
 
   uuid_ctr_ = 0;
 
   fetched_instrs_ = 0;
   perf_stats_ = PerfStats();
+  std::fill(symbol_instrs_.begin(), symbol_instrs_.end(), 0);
 
   fetch_stalled_->reset();
+  fetch_delay_ = 0;
+  fetch_ready_ = false;
+  icache_pending_ = false;
+
+  for (auto& port : mem_ports_) {
+    std::queue<mem_req_t>().swap(port.queue);
+    port.requests = 0;
+    port.stalls = 0;
+  }
+  mem_grant_ = 0;
+  dmem_xlat_ = 0;
+  cdb_grant_ = 0;
+  load_wakeups_.clear();
+  replays_.clear();
+
+  mmu_.set_satp(0);
+  mmu_.sfence(false, 0, false, 0);
+
+  icache_.reset();
+  dcache_.reset();
+  prefetcher_.reset();
+  LSQ_.reset();
+  store_sets_.reset();
+  if (stack_dist_) {
+    stack_dist_->reset();
+  }
+
+  // the architectural registers start in the first physical registers
+  if (RENAME_SCHEME == RENAME_PRF) {
+    PRF_.reset(NUM_REGS);
+    for (uint32_t reg = 0; reg < NUM_REGS; ++reg) {
+      RAT_.set(reg, reg);
+      arch_RAT_.set(reg, reg);
+    }
+  }
+
   exited_ = false;
 }
 
 void Core::tick() {
+  this->mem_response();
+
   this->commit();
   this->writeback();
   this->execute();
@@ -74,84 +149,305 @@ void Core::tick() {
   this->decode();
   this->fetch();
 
+  this->mem_arbitrate();
+
   ++perf_stats_.cycles;
   DPN(2, std::flush);
 }
 
 void Core::fetch() {
-  if (fetch_stalled_->read() || decode_queue_->full())
+  if (fetch_stalled_->read() || decode_queue_->full() || icache_pending_)
+    return;
+
+  if (!fetch_ready_) {
+    // translate and read up to ISSUE_WIDTH instructions from the line at PC.
+    // branches, jumps and system instructions end the group,
+    // the next PC is only known once they are decoded or executed.
+    uint32_t line_size = ICACHE_ENABLED ? icache_.config().line_size : CACHE_LINE_SIZE;
+    uint32_t xlat = 0;
+    Word PC = PC_;
+    fetch_codes_.clear();
+    do {
+      uint32_t code;
+      try {
+        mmu_.fetch(&code, PC, sizeof(uint32_t));
+      } catch (const MemoryUnit::PageFault& fault) {
+        this->page_fault(fault);
+      }
+      if (fetch_codes_.empty()) {
+        xlat = this->xlat_latency();
+      }
+      fetch_codes_.push_back(code);
+      PC += 4;
+      auto opcode = Opcode(code & 0x7f);
+      if (opcode == Opcode::B || opcode == Opcode::JAL
+       || opcode == Opcode::JALR || opcode == Opcode::SYS)
+        break;
+    } while (fetch_codes_.size() < ISSUE_WIDTH && (PC % line_size) != 0);
+    fetch_delay_ = xlat;
+    fetch_ready_ = true;
+
+    // wait for the instruction cache
+    if (ICACHE_ENABLED) {
+      bool hit = icache_.access(PC_, false);
+      if (!hit && DRAM_ENABLED) {
+        // fetch the line from memory, then complete as a hit
+        this->mem_request(icache_port_, MemReq{icache_.line_addr(PC_) * line_size, false, 0}, xlat);
+        fetch_delay_ = icache_.latency(true) - 1;
+        icache_pending_ = true;
+        return;
+      }
+      fetch_delay_ += icache_.latency(hit) - 1;
+    }
+  }
+  if (fetch_delay_ != 0) {
+    --fetch_delay_;
     return;
+  }
+  fetch_ready_ = false;
 
-  // allocate a new uuid
-  uint32_t uuid = uuid_ctr_++;
+  std::vector<id_data_t> fetch_group;
+  for (auto code : fetch_codes_) {
+    // allocate a new uuid
+    uint32_t uuid = uuid_ctr_++;
 
-  // fetch next instruction from memory at PC address
-  uint32_t instr_code = 0;
-  mmu_.read(&instr_code, PC_, sizeof(uint32_t), 0);
+    DT(2, "Fetch: instr=0x" << code << ", PC=0x" << std::hex << PC_ << std::dec << " (#" << uuid << ")");
 
-  DT(2, "Fetch: instr=0x" << instr_code << ", PC=0x" << std::hex << PC_ << std::dec << " (#" << uuid << ")");
+    fetch_group.push_back({code, PC_, uuid, PC_ + 4});
 
-  // move instruction data to next stage
-  decode_queue_->push({instr_code, PC_, uuid});
+    // advance program counter
+    PC_ += 4;
 
-  // advance program counter
-  PC_ += 4;
+    ++fetched_instrs_;
+  }
 
-  ++fetched_instrs_;
+  if (bpred_) {
+    // continue along the predicted path,
+    // only system instructions wait for decode
+    auto& last = fetch_group.back();
+    bool stall = false;
+    switch (Opcode(last.instr_code & 0x7f)) {
+    case Opcode::B:
+      last.pred_PC = bpred_->predict(last.PC);
+      break;
+    case Opcode::JAL: {
+      // the jump target is known from the instruction
+      uint32_t code = last.instr_code;
+      uint32_t offset = ((code >> 31) << 20) | (((code >> 12) & 0xff) << 12)
+                      | (((code >> 20) & 0x1) << 11) | (((code >> 21) & 0x3ff) << 1);
+      last.pred_PC = last.PC + sext(offset, 21);
+    } break;
+    case Opcode::JALR:
+      last.pred_PC = bpred_->predict(last.PC);
+      if (last.pred_PC == last.PC + 4) {
+        // no target in the BTB, wait for the jump
+        last.pred_PC = NO_TARGET;
+        stall = true;
+      }
+      break;
+    case Opcode::SYS:
+      stall = true;
+      break;
+    default:
+      break;
+    }
+    PC_ = last.pred_PC;
+    if (stall) {
+      fetch_stalled_->write(true);
+    }
+  } else {
+    // This pipeline has no support for branch prediction,
+    // we should all the fetch stage until decode
+    fetch_stalled_->write(true);
+  }
 
-  // This pipeline has no support for branch prediction,
-  // we should all the fetch stage until decode
-  fetch_stalled_->write(true);
+  // move instruction data to next stage
+  decode_queue_->push(fetch_group);
 }
 
-void Core::decode() {
-  if (decode_queue_->empty() || issue_queue_->full())
-    return;
+uint32_t Core::mem_attach(const char* name, const mem_handler_t& handler) {
+  // the port id travels in the top 8 bits of the memory tag
+  assert(mem_ports_.size() < 256);
+  mem_ports_.push_back({name, handler, {}, 0, 0});
+  return mem_ports_.size() - 1;
+}
 
-  auto& id_data = decode_queue_->data();
+void Core::mem_request(uint32_t port, const MemReq& req, uint32_t delay) {
+  assert(req.tag < (1u << 24));
+  auto& mem_port = mem_ports_.at(port);
+  MemReq port_req{req.addr, req.write, (port << 24) | req.tag};
+  mem_port.queue.push({port_req, SimPlatform::instance().cycles() + delay});
+  ++mem_port.requests;
+}
 
-  // instruction decode
-  auto instr = this->decode(id_data.instr_code, id_data.PC, id_data.uuid);
+void Core::mem_arbitrate() {
+  uint64_t now = SimPlatform::instance().cycles();
+  uint32_t num_ports = mem_ports_.size();
+  auto ready = [&](uint32_t port) {
+    auto& queue = mem_ports_[port].queue;
+    return !queue.empty() && queue.front().ready <= now;
+  };
+  uint32_t pending = 0;
+  for (uint32_t port = 0; port < num_ports; ++port) {
+    pending += ready(port);
+  }
+  if (pending > MEM_PORT_WIDTH) {
+    ++perf_stats_.mem_conflicts;
+  }
 
-  DT(2, "Decode: " << *instr);
+  // round-robin between the requesters, one request per grant
+  for (uint32_t i = 0; i < MEM_PORT_WIDTH && pending != 0; ++i) {
+    uint32_t port = mem_grant_;
+    while (!ready(port)) {
+      port = (port + 1) % num_ports;
+    }
+    auto& queue = mem_ports_[port].queue;
+    DT(3, "Mem Request: " << queue.front().req);
+    mem_req_port.send(queue.front().req);
+    queue.pop();
+    mem_grant_ = (port + 1) % num_ports;
+    if (!ready(port)) {
+      --pending;
+    }
+  }
 
-  // release fetch stage if not a branch
-  // keep fetch stage locked if exiting program
-  if (instr->getBrOp() == BrOp::NONE
-   && !instr->getExeFlags().is_exit) {
-    fetch_stalled_->write(false); // unlock fetch stage
+  // structural hazards on the shared port
+  for (uint32_t port = 0; port < num_ports; ++port) {
+    if (ready(port)) {
+      ++mem_ports_[port].stalls;
+    }
   }
+}
 
-  // move instruction data to next stage
-  issue_queue_->push({instr});
-  decode_queue_->pop();
+void Core::mem_response() {
+  while (!mem_rsp_port.empty()) {
+    auto& rsp = mem_rsp_port.front();
+    DT(3, "Mem Response: " << rsp);
+    auto& mem_port = mem_ports_.at(rsp.tag >> 24);
+    if (mem_port.handler) {
+      mem_port.handler(rsp.tag & 0xffffff);
+    }
+    mem_rsp_port.pop();
+  }
+}
+
+void Core::decode() {
+  // decode queued fetch groups, up to ISSUE_WIDTH instructions per cycle
+  uint32_t decoded = 0;
+  while (!decode_queue_->empty() && !issue_queue_->full()) {
+    auto& fetch_group = decode_queue_->data();
+    if (decoded + fetch_group.size() > ISSUE_WIDTH)
+      break;
+    decoded += fetch_group.size();
+
+    std::vector<is_data_t> issue_group;
+    for (auto& id_data : fetch_group) {
+      // instruction decode
+      auto instr = this->decode(id_data.instr_code, id_data.PC, id_data.uuid);
+      instr->setPredPC(id_data.pred_PC);
+
+      DT(2, "Decode: " << *instr);
+
+      // fuse with the previous instruction of the group
+      if (MACRO_FUSION && !issue_group.empty()) {
+        auto fused = this->fuse(issue_group.back().instr, instr);
+        if (fused) {
+          DT(2, "Fuse: " << *fused);
+          issue_group.back().instr = fused;
+          continue;
+        }
+      }
+
+      issue_group.push_back({instr});
+    }
+
+    // release fetch stage if it waits for this group, which is any group
+    // without a branch predictor, else one ending with a system instruction.
+    // keep it locked on branches until they resolve,
+    // keep fetch stage locked if exiting program
+    // or until a serializing instruction executes
+    auto& last = *issue_group.back().instr;
+    bool waiting = !bpred_ || last.getOpcode() == Opcode::SYS;
+    if (waiting
+     && last.getBrOp() == BrOp::NONE
+     && !last.getExeFlags().is_exit
+     && !is_serializing(last)) {
+      fetch_stalled_->write(false); // unlock fetch stage
+    }
+
+    // move instruction data to next stage
+    issue_queue_->push(issue_group);
+    decode_queue_->pop();
+  }
 }
 
 void Core::dmem_read(void *data, uint64_t addr, uint32_t size) {
   auto type = get_addr_type(addr);
   __unused (type);
-  mmu_.read(data, addr, size, 0);
+  try {
+    mmu_.read(data, addr, size, 0);
+  } catch (const MemoryUnit::PageFault& fault) {
+    this->page_fault(fault);
+  }
+  dmem_xlat_ = this->xlat_latency();
   DT(2, "Mem Read: addr=0x" << std::hex << addr << ", data=0x" << ByteStream(data, size) << " (size=" << size << ", type=" << type << ")");
 }
 
 void Core::dmem_write(const void* data, uint64_t addr, uint32_t size) {
   auto type = get_addr_type(addr);
   __unused (type);
+  dmem_xlat_ = 0;
   if (addr >= uint64_t(IO_COUT_ADDR)
    && addr < (uint64_t(IO_COUT_ADDR) + IO_COUT_SIZE)) {
      this->writeToStdOut(data);
   } else {
-    mmu_.write(data, addr, size, 0);
+    try {
+      mmu_.write(data, addr, size, 0);
+    } catch (const MemoryUnit::PageFault& fault) {
+      this->page_fault(fault);
+    }
+    dmem_xlat_ = this->xlat_latency();
   }
   DT(2, "Mem Write: addr=0x" << std::hex << addr << ", data=0x" << ByteStream(data, size) << " (size=" << size << ", type=" << type << ")");
 }
 
+uint32_t Core::xlat_latency() {
+  auto& xlat = mmu_.last_translation();
+  switch (xlat.level) {
+  case MemoryUnit::XLAT_L2:
+    return L2TLB_LATENCY;
+  case MemoryUnit::XLAT_WALK: {
+    // the walk reads each level through the data cache
+    uint32_t latency = L2TLB_LATENCY;
+    for (uint32_t i = 0; i < xlat.num_ptes; ++i) {
+      if (DCACHE_ENABLED) {
+        latency += dcache_.latency(dcache_.access(xlat.pte_addr[i], false));
+      } else {
+        latency += LSU_LATENCY;
+      }
+    }
+    return latency;
+  }
+  default:
+    // no translation or L1 TLB hit
+    return 0;
+  }
+}
+
+void Core::page_fault(const MemoryUnit::PageFault& fault) {
+  // traps are not supported
+  std::cout << std::hex << "Error: " << (fault.notFound ? "page fault" : "access fault")
+            << " addr=0x" << fault.faultAddr << std::dec << std::endl;
+  std::abort();
+}
+
 uint32_t Core::get_csr(uint32_t addr) {
   // stall-independent mcycle workaround for software timing consistency
   uint64_t ideal_mcycles = (perf_stats_.instrs-1) + 5;
   switch (addr) {
-  case VX_CSR_MHARTID:
   case VX_CSR_SATP:
+    return mmu_.get_satp();
+  case VX_CSR_MHARTID:
   case VX_CSR_PMPCFG0:
   case VX_CSR_PMPADDR0:
   case VX_CSR_MSTATUS:
@@ -181,6 +477,8 @@ uint32_t Core::get_csr(uint32_t addr) {
 void Core::set_csr(uint32_t addr, uint32_t value) {
   switch (addr) {
   case VX_CSR_SATP:
+    mmu_.set_satp(value);
+    break;
   case VX_CSR_MSTATUS:
   case VX_CSR_MEDELEG:
   case VX_CSR_MIDELEG:
@@ -216,7 +514,7 @@ void Core::cout_flush() {
 
 bool Core::check_exit(Word* exitcode, bool riscv_test) const {
   if (exited_) {
-    Word ec = reg_file_.at(3);
+    Word ec = this->arch_reg(3);
     if (riscv_test) {
       *exitcode = (1 - ec);
     } else {
@@ -235,6 +533,244 @@ void Core::attach_ram(RAM* ram) {
   mmu_.attach(*ram, 0, 0xFFFFFFFF);
 }
 
+void Core::attach_symbols(const SymbolTable* symbols) {
+  symbols_ = (symbols && !symbols->empty()) ? symbols : nullptr;
+  symbol_instrs_.assign(symbols_ ? symbols_->size() : 0, 0);
+}
+
+void Core::set_startup_addr(Word addr) {
+  startup_addr_ = addr;
+}
+
+void Core::enable_stack_dist() {
+  stack_dist_.reset(new StackDistance(CACHE_LINE_SIZE, MRC_MAX_SIZE, MRC_MAX_SETS));
+}
+
+void Core::enable_gshare() {
+  bpred_.reset(new GShare(BTB_SIZE, BHR_SIZE));
+}
+
+void Core::recover(int rob_index, Word PC) {
+  // flush the younger instructions from the ROB,
+  // their reservation stations and functional units
+  perf_stats_.squashed += ROB_.squash(rob_index);
+  auto& valid = RS_.valid();
+  for (int rs_index = valid.next(0); rs_index != -1; rs_index = valid.next(rs_index + 1)) {
+    if (!ROB_.valid(RS_.rob_index(rs_index))) {
+      RS_.release(rs_index);
+    }
+  }
+  for (auto fu : FUs_) {
+    fu->squash(ROB_);
+  }
+  LSQ_.squash(ROB_, store_sets_);
+
+  // rebuild the RAT from the remaining ROB entries,
+  // with physical registers, on top of the committed mappings
+  // and releasing the registers of the squashed instructions.
+  std::vector<uint32_t> refs(PRF_.size(), 0);
+  for (uint32_t reg = 0; reg < NUM_REGS; ++reg) {
+    if (RENAME_SCHEME == RENAME_PRF) {
+      RAT_.set(reg, arch_RAT_.get(reg));
+      ++refs.at(arch_RAT_.get(reg));
+    } else {
+      RAT_.clear(reg);
+    }
+  }
+  for (uint32_t i = 0; i < ROB_.count(); ++i) {
+    int index = (ROB_.head_index() + i) % ROB_.size();
+    auto& entry = ROB_.get_entry(index);
+    auto& instr = *entry.instr;
+    if (instr.getExeFlags().use_rd && instr.getRd() != 0) {
+      if (RENAME_SCHEME == RENAME_PRF) {
+        RAT_.set(instr.getRd(), entry.pdst);
+        ++refs.at(entry.pdst);
+      } else {
+        RAT_.set(instr.getRd(), index);
+      }
+    }
+  }
+  if (RENAME_SCHEME == RENAME_PRF) {
+    PRF_.rebuild(refs);
+  }
+
+  // flush the front-end and restart fetch,
+  // a pending instruction cache fill still completes
+  decode_queue_->reset();
+  issue_queue_->reset();
+  issue_index_ = 0;
+  fetch_ready_ = false;
+  fetch_delay_ = 0;
+  fetch_stalled_->write(false);
+  PC_ = PC;
+}
+
+Word Core::arch_reg(uint32_t reg) const {
+  if (RENAME_SCHEME == RENAME_PRF)
+    return PRF_.read(arch_RAT_.get(reg));
+  return reg_file_.at(reg);
+}
+
+uint32_t Core::resolved_count() const {
+  return ROB_.resolved_count();
+}
+
+int Core::free_unit(FUType type) const {
+  for (uint32_t f = fu_base_.at((int)type); f < fu_base_.at((int)type + 1); ++f) {
+    if (!FUs_[f]->busy())
+      return f;
+  }
+  return -1;
+}
+
+FUType Core::unit_type(int fu_index) const {
+  int type = 0;
+  while (fu_base_.at(type + 1) <= (uint32_t)fu_index) {
+    ++type;
+  }
+  return (FUType)type;
+}
+
+std::string Core::symbol_name(Word PC) const {
+  if (symbols_ == nullptr)
+    return "";
+  int index = symbols_->lookup(PC);
+  if (index < 0)
+    return "";
+  auto& symbol = symbols_->get(index);
+  std::stringstream ss;
+  ss << " <" << symbol.name;
+  if (PC != symbol.addr) {
+    ss << "+0x" << std::hex << (PC - symbol.addr);
+  }
+  ss << ">";
+  return ss.str();
+}
+
 void Core::showStats() {
   std::cout << std::dec << "PERF: instrs=" << perf_stats_.instrs << ", cycles=" << perf_stats_.cycles << std::endl;
+  if (ICACHE_ENABLED) {
+    icache_.showStats();
+  }
+  if (DCACHE_ENABLED) {
+    dcache_.showStats();
+    if (prefetcher_.enabled()) {
+      prefetcher_.showStats();
+    }
+  }
+  auto& lsu_stats = lsu_->perf_stats();
+  std::cout << "PERF: lsu: loads=" << lsu_stats.loads
+            << ", stores=" << lsu_stats.stores
+            << ", mshr merges=" << lsu_stats.mshr_merges
+            << ", mshr full cycles=" << lsu_stats.mshr_full_cycles
+            << ", max inflight=" << lsu_stats.max_inflight << std::endl;
+  auto& lsq_stats = LSQ_.perf_stats();
+  std::cout << "PERF: lsq: forwards=" << lsq_stats.forwards
+            << ", blocked loads=" << lsq_stats.blocked;
+  if (MEM_DEP_POLICY != MEM_DEP_CONSERVATIVE) {
+    std::cout << ", speculative loads=" << lsq_stats.speculative
+              << ", violations=" << lsq_stats.violations
+              << ", held loads=" << lsq_stats.held
+              << ", false dependences=" << lsq_stats.false_deps;
+  }
+  std::cout << std::endl;
+  if (SPECULATIVE_WAKEUP) {
+    std::cout << "PERF: wakeup: speculative load wakeups=" << perf_stats_.load_wakeups
+              << ", missed=" << perf_stats_.load_misses
+              << ", replays=" << perf_stats_.replays << std::endl;
+  }
+  if (MOVE_ELIMINATION) {
+    std::cout << "PERF: rename: eliminated moves=" << perf_stats_.eliminated_moves
+              << ", eliminated constants=" << perf_stats_.eliminated_consts << std::endl;
+  }
+  if (MACRO_FUSION) {
+    std::cout << "PERF: fusion: pairs=" << perf_stats_.fused;
+    if (perf_stats_.instrs != 0) {
+      std::cout << std::fixed << std::setprecision(2)
+                << ", rate=" << (100.0 * 2 * perf_stats_.fused / perf_stats_.instrs) << "%";
+      std::cout.unsetf(std::ios::floatfield);
+    }
+    std::cout << std::endl;
+  }
+  std::cout << "PERF: frontend: fetch queue=" << FETCH_QUEUE_SIZE
+            << ", decode buffer=" << DECODE_BUFFER_SIZE
+            << ", frontend bound cycles=" << perf_stats_.frontend_bound
+            << ", backend bound cycles=" << perf_stats_.backend_bound << std::endl;
+  std::cout << "PERF: commit: width=" << COMMIT_WIDTH
+            << std::fixed << std::setprecision(2);
+  for (uint32_t i = 0; i <= COMMIT_WIDTH; ++i) {
+    std::cout << ", " << i << "=" << perf_stats_.commits[i];
+    if (perf_stats_.cycles != 0) {
+      std::cout << " (" << (100.0 * perf_stats_.commits[i] / perf_stats_.cycles) << "%)";
+    }
+  }
+  std::cout.unsetf(std::ios::floatfield);
+  std::cout << std::endl;
+  std::cout << "PERF: fu:" << std::fixed << std::setprecision(2);
+  for (int t = 0; t < (int)FUType::NONE; ++t) {
+    for (uint32_t f = fu_base_[t]; f < fu_base_[t + 1]; ++f) {
+      std::cout << ((f != 0) ? ", " : " ") << (FUType)t << (f - fu_base_[t])
+                << " ops=" << perf_stats_.fu_ops[f];
+      if (perf_stats_.cycles != 0) {
+        std::cout << " (busy " << (100.0 * perf_stats_.fu_busy[f] / perf_stats_.cycles) << "%)";
+      }
+    }
+  }
+  std::cout.unsetf(std::ios::floatfield);
+  std::cout << std::endl;
+  std::cout << "PERF: cdb: results=" << perf_stats_.cdb_results
+            << ", stall cycles=" << perf_stats_.cdb_stalls;
+  for (int t = 0; t < (int)FUType::NONE; ++t) {
+    std::cout << ", " << (FUType)t << " stalls=" << perf_stats_.cdb_fu_stalls[t];
+  }
+  std::cout << std::endl;
+  if (RENAME_SCHEME == RENAME_PRF) {
+    std::cout << "PERF: prf: registers=" << NUM_PREGS
+              << ", rename stalls=" << perf_stats_.rename_stalls << std::endl;
+  }
+  if (bpred_) {
+    std::cout << "PERF: bpred: branches=" << perf_stats_.branches
+              << ", mispredicts=" << perf_stats_.mispredicts
+              << std::fixed << std::setprecision(2);
+    if (perf_stats_.branches != 0) {
+      std::cout << ", accuracy=" << (100.0 * (perf_stats_.branches - perf_stats_.mispredicts) / perf_stats_.branches) << "%";
+    }
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout << ", squashed=" << perf_stats_.squashed
+              << ", wrong-path fetches=" << (fetched_instrs_ - perf_stats_.instrs) << std::endl;
+  }
+  if (DRAM_ENABLED) {
+    std::cout << "PERF: mem port:";
+    for (auto& port : mem_ports_) {
+      std::cout << " " << port.name << " requests=" << port.requests
+                << ", " << port.name << " stalls=" << port.stalls << ",";
+    }
+    std::cout << " conflicts=" << perf_stats_.mem_conflicts << std::endl;
+  }
+  auto& mmu_stats = mmu_.perf_stats();
+  if (mmu_stats.itlb_hits + mmu_stats.itlb_misses + mmu_stats.dtlb_hits + mmu_stats.dtlb_misses != 0) {
+    std::cout << "PERF: tlb: itlb hits=" << mmu_stats.itlb_hits
+              << ", itlb misses=" << mmu_stats.itlb_misses
+              << ", dtlb hits=" << mmu_stats.dtlb_hits
+              << ", dtlb misses=" << mmu_stats.dtlb_misses
+              << ", l2tlb hits=" << mmu_stats.l2tlb_hits
+              << ", l2tlb misses=" << mmu_stats.l2tlb_misses
+              << ", pte reads=" << mmu_stats.pte_reads << std::endl;
+  }
+
+  // per-function instruction profile
+  if (symbols_) {
+    std::vector<int> order;
+    for (int i = 0; i < (int)symbol_instrs_.size(); ++i) {
+      if (symbol_instrs_[i] != 0) {
+        order.push_back(i);
+      }
+    }
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+      return symbol_instrs_[a] > symbol_instrs_[b];
+    });
+    for (int i : order) {
+      std::cout << "PERF: " << symbols_->get(i).name << ": instrs=" << symbol_instrs_[i] << std::endl;
+    }
+  }
 }
@@ -22,8 +22,10 @@
 #include <sstream>
 #include <memory>
 #include <set>
+#include <functional>
 #include <simobject.h>
 #include <mem.h>
+#include <symtab.h>
 #include "debug.h"
 #include "types.h"
 #include "val_reg.h"
@@ -33,8 +35,16 @@
 #include "RS.h"
 #include "RST.h"
 #include "ROB.h"
+#include "PRF.h"
+#include "LSQ.h"
 #include "FU.h"
 #include "CDB.h"
+#include "cache.h"
+#include "dram.h"
+#include "prefetcher.h"
+#include "stack_dist.h"
+#include "gshare.h"
+#include "store_set.h"
 
 namespace tinyrv {
 
@@ -47,13 +57,54 @@ public:
   struct PerfStats {
     uint64_t cycles;
     uint64_t instrs;
+    uint64_t mem_conflicts;     // cycles with more requests than ports
+    uint64_t cdb_results;
+    uint64_t cdb_stalls;        // cycles results waited for a free CDB
+    uint64_t cdb_fu_stalls[(int)FUType::NONE]; // the same, by unit type
+    uint64_t branches;
+    uint64_t mispredicts;
+    uint64_t squashed;          // ROB entries flushed on mispredicts
+    uint64_t rename_stalls;     // cycles issue waited for a free physical register
+    uint64_t eliminated_moves;  // moves completed at rename
+    uint64_t eliminated_consts; // zero idioms and constants completed at rename
+    uint64_t fused;             // committed macro-op fused pairs
+    uint64_t load_wakeups;      // loads that woke their consumers speculatively
+    uint64_t load_misses;       // loads that missed their scheduled wakeup
+    uint64_t replays;           // instructions cancelled and returned to the RS
+    uint64_t frontend_bound;    // cycles issue ran out of decoded instructions
+    uint64_t backend_bound;     // cycles issue stalled on a full ROB, RS, PRF or LSQ
+    uint64_t commits[COMMIT_WIDTH + 1]; // cycles by number of retired instructions
+    uint64_t fu_ops[NUM_FUS];   // instructions dispatched to each unit
+    uint64_t fu_busy[NUM_FUS];  // cycles each unit had operations in flight
 
     PerfStats()
       : cycles(0)
       , instrs(0)
+      , mem_conflicts(0)
+      , cdb_results(0)
+      , cdb_stalls(0)
+      , cdb_fu_stalls()
+      , branches(0)
+      , mispredicts(0)
+      , squashed(0)
+      , rename_stalls(0)
+      , eliminated_moves(0)
+      , eliminated_consts(0)
+      , fused(0)
+      , load_wakeups(0)
+      , load_misses(0)
+      , replays(0)
+      , frontend_bound(0)
+      , backend_bound(0)
+      , commits()
+      , fu_ops()
+      , fu_busy()
     {}
   };
 
+  SimPort<MemReq> mem_req_port;
+  SimPort<MemRsp> mem_rsp_port;
+
   Core(const SimContext& ctx, uint32_t core_id, ProcessorImpl* processor);
   ~Core();
 
@@ -63,6 +114,20 @@ public:
 
   void attach_ram(RAM* ram);
 
+  void attach_symbols(const SymbolTable* symbols);
+
+  void set_startup_addr(Word addr);
+
+  // record the data address stream for miss-ratio curves
+  void enable_stack_dist();
+
+  // predict branches with GShare and fetch speculatively
+  void enable_gshare();
+
+  const StackDistance* stack_dist() const {
+    return stack_dist_.get();
+  }
+
   bool running() const;
 
   bool check_exit(Word* exitcode, bool riscv_test) const;
@@ -73,10 +138,42 @@ private:
 
   Instr::Ptr decode(uint32_t instr_code, uint32_t PC, uint64_t uuid) const;
 
+  // fuse two adjacent instructions into one micro-op, or return nullptr
+  Instr::Ptr fuse(const Instr::Ptr& head, const Instr::Ptr& tail) const;
+
   void dmem_read(void* data, uint64_t addr, uint32_t size);
 
   void dmem_write(const void* data, uint64_t addr, uint32_t size);
 
+  // SATP writes and SFENCE.VMA change translations,
+  // they execute alone at the ROB head with fetch stalled.
+  static bool is_serializing(const Instr& instr) {
+    auto exe_flags = instr.getExeFlags();
+    return exe_flags.is_sfence
+        || (exe_flags.is_csr && instr.getImm() == VX_CSR_SATP);
+  }
+
+  // squash the instructions younger than the given ROB entry
+  // and restart fetch at PC
+  void recover(int rob_index, Word PC);
+
+  // ROB entries older than the oldest unresolved branch
+  uint32_t resolved_count() const;
+
+  // first free unit of the given type, or -1
+  int free_unit(FUType type) const;
+
+  // type of a unit of the pool
+  FUType unit_type(int fu_index) const;
+
+  // committed value of an architectural register
+  Word arch_reg(uint32_t reg) const;
+
+  // latency of the last address translation
+  uint32_t xlat_latency();
+
+  [[noreturn]] void page_fault(const MemoryUnit::PageFault& fault);
+
   void set_csr(uint32_t addr, uint32_t value);
 
   uint32_t get_csr(uint32_t addr);
@@ -85,12 +182,34 @@ private:
 
   void cout_flush();
 
+  std::string symbol_name(Word PC) const;
+
+  // memory response callback, called with the requester's own tag
+  typedef std::function<void(uint32_t tag)> mem_handler_t;
+
+  // register a requester of the shared memory port, return its port id.
+  // ports are granted round-robin in registration order.
+  uint32_t mem_attach(const char* name, const mem_handler_t& handler);
+
+  // queue a request for the shared memory port, sent after delay cycles.
+  // the tag is returned to the port's handler, it must fit in 24 bits.
+  void mem_request(uint32_t port, const MemReq& req, uint32_t delay = 0);
+
+  void mem_arbitrate();
+
+  void mem_response();
+
   struct id_data_t {
     uint32_t instr_code;
     Word     PC;
     uint64_t uuid;
+    Word     pred_PC;
   };
 
+  // predicted PC of a jump without a BTB target, fetch waits for it.
+  // instructions are aligned, so it never matches the resolved PC.
+  static constexpr Word NO_TARGET = 0x1;
+
   struct is_data_t {
     Instr::Ptr instr;
   };
@@ -114,17 +233,72 @@ private:
 
   std::vector<Word> reg_file_;
   Word PC_;
+  Word startup_addr_;
 
-  FiFoReg<id_data_t>::Ptr decode_queue_;
-  FiFoReg<is_data_t>::Ptr issue_queue_;
+  // queues of fetch groups of up to ISSUE_WIDTH instructions
+  FiFoReg<std::vector<id_data_t>>::Ptr decode_queue_;
+  FiFoReg<std::vector<is_data_t>>::Ptr issue_queue_;
+  uint32_t issue_index_;  // issued instructions of the head group
   ValReg<bool>::Ptr fetch_stalled_;
+  uint32_t fetch_delay_;
+  bool     fetch_ready_;
+  std::vector<uint32_t> fetch_codes_;
+  bool     icache_pending_;
+
+  Cache icache_;
+  Cache dcache_;
+  Prefetcher prefetcher_;
+  std::unique_ptr<BranchPredictor> bpred_;
+  std::unique_ptr<StackDistance> stack_dist_;
+
+  struct mem_req_t {
+    MemReq   req;
+    uint64_t ready;
+  };
+
+  struct mem_port_t {
+    std::string   name;
+    mem_handler_t handler;
+    std::queue<mem_req_t> queue;
+    uint64_t      requests;
+    uint64_t      stalls;   // cycles waiting for the shared port
+  };
+
+  // requesters of the shared memory port, indexed by port id
+  std::vector<mem_port_t> mem_ports_;
+  uint32_t icache_port_;
+  uint32_t dmem_xlat_;
+  uint32_t mem_grant_;
 
   ReorderBuffer       ROB_;
   RegisterAliasTable  RAT_;
   ReservationStation  RS_;
   RegisterStatusTable RST_;
+  PhysicalRegisterFile PRF_;
+  RegisterAliasTable  arch_RAT_;  // committed mappings (RENAME_PRF)
   CommonDataBus       CDB_;
+  LoadStoreQueue      LSQ_;
+  StoreSetPredictor   store_sets_;
+  uint32_t            cdb_grant_;
+
+  // loads waking their consumers when a hit would return (SPECULATIVE_WAKEUP)
+  struct load_wakeup_t {
+    uint64_t cycle;
+    int      rs_index;
+    int      rob_index;
+  };
+  std::vector<load_wakeup_t> load_wakeups_;
+  // RS entries dispatched before their load returned, and their unit
+  struct replay_t {
+    int rs_index;
+    int fu_index;
+  };
+  std::vector<replay_t> replays_;
+
+  // functional unit pool, the units of a type are contiguous in FUType order
   std::vector<FunctionalUnit::Ptr> FUs_;
+  std::vector<uint32_t> fu_base_;   // first unit of each type, then the pool size
+  std::shared_ptr<LSU> lsu_;
   bool exited_;
 
   std::stringstream cout_buf_;
@@ -134,6 +308,9 @@ private:
   PerfStats perf_stats_;
   uint64_t fetched_instrs_;
 
+  const SymbolTable* symbols_;
+  std::vector<uint64_t> symbol_instrs_;
+
   friend class ALU;
   friend class BRU;
   friend class LSU;
@@ -198,6 +198,8 @@ namespace tinyrv
         case 0x302:
           return "MRET";
         default:
+          if ((imm >> 5) == 0x09)
+            return "SFENCE.VMA";
           std::abort();
         }
       case 1:
@@ -224,6 +226,10 @@ namespace tinyrv
 
   std::ostream &operator<<(std::ostream &os, const Instr &instr)
   {
+    if (instr.getFused())
+    {
+      os << op_string(*instr.getFused()) << "+";
+    }
     os << op_string(instr);
     int sep = 0;
 
@@ -368,6 +374,12 @@ Instr::Ptr Core::decode(uint32_t instr_code, uint32_t PC, uint64_t uuid) const
           exe_flags.use_rs1 = 1;
         }
       }
+      else if ((imm12 >> 5) == 0x09)
+      {
+        // SFENCE.VMA: rs1 = address, rs2 = ASID
+        exe_flags.use_rs1 = 1;
+        exe_flags.use_rs2 = 1;
+      }
       imm = imm12;
     }
     break;
@@ -617,6 +629,11 @@ Instr::Ptr Core::decode(uint32_t instr_code, uint32_t PC, uint64_t uuid) const
       case 0x302: // RV32I: MRET
         break;
       default:
+        if ((imm >> 5) == 0x09) {
+          // RV32S: SFENCE.VMA
+          exe_flags.is_sfence = 1;
+          break;
+        }
         std::abort();
       }
     }
@@ -688,9 +705,9 @@ Instr::Ptr Core::decode(uint32_t instr_code, uint32_t PC, uint64_t uuid) const
   // HINT: use the exe_flags as well
   // TODO:
   // Functional unit type decoding
-  if (exe_flags.is_csr)
+  if (exe_flags.is_csr || exe_flags.is_sfence)
   {
-    // CSR instructions go to Special Function Unit
+    // CSR and SFENCE.VMA instructions go to Special Function Unit
     fu_type = FUType::SFU;
   }
   else if (exe_flags.is_load || exe_flags.is_store)
@@ -722,4 +739,73 @@ Instr::Ptr Core::decode(uint32_t instr_code, uint32_t PC, uint64_t uuid) const
   instr->setFUType(fu_type);
 
   return instr;
-}
\ No newline at end of file
+}
+
+Instr::Ptr Core::fuse(const Instr::Ptr& head, const Instr::Ptr& tail) const
+{
+  // the pair must pass the first result through rs1 of the second instruction
+  auto head_flags = head->getExeFlags();
+  auto tail_flags = tail->getExeFlags();
+  auto rd = head->getRd();
+  if (head->getFused() || !head_flags.use_rd
+   || !tail_flags.use_rs1 || tail->getRs1() != rd
+   || (tail_flags.use_rs2 && tail->getRs2() != 0))
+    return nullptr;
+
+  auto head_op = head->getOpcode();
+  auto tail_op = tail->getOpcode();
+  bool is_addi = (tail_op == Opcode::I && tail->getFunc3() == 0);
+  bool is_test = (tail->getBrOp() == BrOp::BEQ || tail->getBrOp() == BrOp::BNE);
+  bool fusible = false;
+  switch (head_op)
+  {
+  case Opcode::LUI:
+    // constant materialization
+    fusible = is_addi;
+    break;
+  case Opcode::AUIPC:
+    // PC-relative address or far call
+    fusible = is_addi || tail_op == Opcode::JALR;
+    break;
+  case Opcode::I:
+    if (head->getFunc3() == 1)
+    {
+      // zero-extension: SLLI+SRLI by the same amount
+      fusible = (tail_op == Opcode::I && tail->getFunc3() == 5
+              && tail->getFunc7() == 0 && tail->getImm() == head->getImm());
+    }
+    else
+    {
+      // SLTI/SLTIU then BEQ/BNE against x0
+      fusible = (head->getFunc3() == 2 || head->getFunc3() == 3) && is_test;
+    }
+    break;
+  case Opcode::R:
+    // SLT/SLTU then BEQ/BNE against x0
+    fusible = (head->getFunc3() == 2 || head->getFunc3() == 3) && is_test;
+    break;
+  default:
+    break;
+  }
+  if (!fusible)
+    return nullptr;
+
+  // the first result must be overwritten by the second instruction,
+  // a conditional branch writes it instead
+  if (!is_test && !(tail_flags.use_rd && tail->getRd() == rd))
+    return nullptr;
+
+  // the fused micro-op reads the sources of the first instruction
+  auto fused = std::make_shared<Instr>(*tail);
+  auto exe_flags = tail_flags;
+  exe_flags.use_rd  = 1;
+  exe_flags.use_rs1 = head_flags.use_rs1;
+  exe_flags.use_rs2 = head_flags.use_rs2;
+  fused->setRd(rd);
+  fused->setSrc1(head->getRs1());
+  fused->setSrc2(head->getRs2());
+  fused->setExeFlags(exe_flags);
+  fused->setFused(head);
+
+  return fused;
+}
@@ -0,0 +1,152 @@
+// Copyright 2024 Blaise Tine
+//
+// Licensed under the Apache License;
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <iostream>
+#include <iomanip>
+#include <assert.h>
+#include <util.h>
+#include "types.h"
+#include "debug.h"
+#include "dram.h"
+
+using namespace tinyrv;
+
+// DRAM timings in core cycles
+static constexpr uint64_t dram_cycles(uint64_t n) {
+  return n * ((MEM_CYCLE_RATIO > 0) ? MEM_CYCLE_RATIO : 1);
+}
+
+DramController::DramController(const SimContext& ctx)
+  : SimObject(ctx, "dram")
+  , req_port(this)
+  , rsp_port(this)
+  , banks_(MEMORY_BANKS)
+  , block_bits_(log2ceil(MEM_BLOCK_SIZE))
+  , bank_bits_(log2ceil(MEMORY_BANKS))
+  , column_bits_(log2ceil(DRAM_ROW_SIZE / MEM_BLOCK_SIZE))
+{
+  static_assert(ispow2(MEMORY_BANKS), "invalid MEMORY_BANKS");
+  static_assert(ispow2(MEM_BLOCK_SIZE), "invalid MEM_BLOCK_SIZE");
+  static_assert(ispow2(DRAM_ROW_SIZE) && DRAM_ROW_SIZE >= MEM_BLOCK_SIZE, "invalid DRAM_ROW_SIZE");
+  this->reset();
+}
+
+DramController::~DramController() {
+  //--
+}
+
+void DramController::reset() {
+  for (auto& bank : banks_) {
+    bank = {false, 0, 0};
+  }
+  queue_.clear();
+  bus_ready_ = 0;
+  perf_stats_ = PerfStats();
+}
+
+void DramController::tick() {
+  uint64_t now = SimPlatform::instance().cycles();
+
+  // accept new requests,
+  // consecutive blocks are interleaved across banks: | row | column | bank | offset |
+  while (!req_port.empty() && queue_.size() < DRAM_QUEUE_SIZE) {
+    auto req = req_port.front();
+    uint64_t block = req.addr >> block_bits_;
+    uint32_t bank = block & (MEMORY_BANKS - 1);
+    uint64_t row = block >> (bank_bits_ + column_bits_);
+    uint64_t arrival = req_port.pop();
+    queue_.push_back({req, bank, row, arrival});
+  }
+
+  if (queue_.empty())
+    return;
+
+  // FR-FCFS: oldest row hit to a ready bank first, then oldest request to a ready bank
+  auto selected = queue_.end();
+  for (auto it = queue_.begin(); it != queue_.end(); ++it) {
+    auto& bank = banks_[it->bank];
+    if (bank.ready > now)
+      continue;
+    if (bank.row_open && bank.row == it->row) {
+      selected = it;
+      break;
+    }
+    if (selected == queue_.end()) {
+      selected = it;
+    }
+  }
+
+  if (selected == queue_.end()) {
+    ++perf_stats_.bank_stalls;
+    return;
+  }
+
+  auto& bank = banks_[selected->bank];
+  uint64_t access;
+  if (bank.row_open && bank.row == selected->row) {
+    access = dram_cycles(DRAM_tCAS);
+    ++perf_stats_.row_hits;
+  } else if (!bank.row_open) {
+    access = dram_cycles(DRAM_tRCD + DRAM_tCAS);
+    ++perf_stats_.row_misses;
+  } else {
+    access = dram_cycles(DRAM_tRP + DRAM_tRCD + DRAM_tCAS);
+    ++perf_stats_.row_conflicts;
+  }
+
+  // the data burst waits for the shared bus
+  uint64_t burst = dram_cycles(DRAM_tBURST);
+  uint64_t done = std::max(now + access, bus_ready_) + burst;
+  bus_ready_ = done;
+  perf_stats_.bus_cycles += burst;
+
+  if (DRAM_PAGE_POLICY == DRAM_PAGE_CLOSED) {
+    // auto-precharge after the access
+    bank.row_open = false;
+    bank.ready = done + dram_cycles(DRAM_tRP);
+  } else {
+    bank.row_open = true;
+    bank.row = selected->row;
+    bank.ready = done;
+  }
+
+  if (selected->req.write) {
+    ++perf_stats_.writes;
+  } else {
+    ++perf_stats_.reads;
+  }
+  perf_stats_.queue_delay += now - selected->arrival;
+
+  DT(3, "DRAM: issue " << selected->req << ", bank=" << selected->bank << ", row=0x" << std::hex << selected->row << std::dec << ", done=" << done);
+
+  rsp_port.send(MemRsp{selected->req.tag}, done - now);
+  queue_.erase(selected);
+}
+
+void DramController::showStats() const {
+  uint64_t requests = perf_stats_.reads + perf_stats_.writes;
+  std::cout << std::dec << "PERF: dram: reads=" << perf_stats_.reads
+            << ", writes=" << perf_stats_.writes
+            << ", row hits=" << perf_stats_.row_hits
+            << ", row misses=" << perf_stats_.row_misses
+            << ", row conflicts=" << perf_stats_.row_conflicts
+            << ", bank stalls=" << perf_stats_.bank_stalls
+            << ", bus cycles=" << perf_stats_.bus_cycles;
+  if (requests != 0) {
+    std::cout << std::fixed << std::setprecision(2)
+              << ", row hit rate=" << (100.0 * perf_stats_.row_hits / requests) << "%"
+              << ", avg queue delay=" << (double(perf_stats_.queue_delay) / requests);
+    std::cout.unsetf(std::ios::floatfield);
+  }
+  std::cout << std::endl;
+}
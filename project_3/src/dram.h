@@ -0,0 +1,93 @@
+// Copyright 2024 Blaise Tine
+//
+// Licensed under the Apache License;
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <vector>
+#include <list>
+#include <simobject.h>
+#include "types.h"
+
+namespace tinyrv {
+
+// Banked DRAM timing model.
+// Requests arrive on req_port and are buffered in a DRAM_QUEUE_SIZE queue,
+// an FR-FCFS scheduler issues at most one request per cycle, preferring
+// row-buffer hits to ready banks, and responses leave on rsp_port once
+// their data burst has crossed the shared data bus.
+class DramController : public SimObject<DramController> {
+public:
+  struct PerfStats {
+    uint64_t reads;
+    uint64_t writes;
+    uint64_t row_hits;
+    uint64_t row_misses;      // bank was precharged
+    uint64_t row_conflicts;   // another row was open
+    uint64_t queue_delay;     // cycles from arrival to issue
+    uint64_t bank_stalls;     // cycles with work blocked by busy banks
+    uint64_t bus_cycles;      // data bus busy cycles
+
+    PerfStats()
+      : reads(0)
+      , writes(0)
+      , row_hits(0)
+      , row_misses(0)
+      , row_conflicts(0)
+      , queue_delay(0)
+      , bank_stalls(0)
+      , bus_cycles(0)
+    {}
+  };
+
+  SimPort<MemReq> req_port;
+  SimPort<MemRsp> rsp_port;
+
+  DramController(const SimContext& ctx);
+
+  ~DramController();
+
+  void reset();
+
+  void tick();
+
+  const PerfStats& perf_stats() const {
+    return perf_stats_;
+  }
+
+  void showStats() const;
+
+private:
+
+  struct bank_t {
+    bool     row_open;
+    uint64_t row;
+    uint64_t ready;     // cycle the bank accepts a new command
+  };
+
+  struct request_t {
+    MemReq   req;
+    uint32_t bank;
+    uint64_t row;
+    uint64_t arrival;
+  };
+
+  std::vector<bank_t>  banks_;
+  std::list<request_t> queue_;
+  uint64_t bus_ready_;
+  uint32_t block_bits_;
+  uint32_t bank_bits_;
+  uint32_t column_bits_;
+  PerfStats perf_stats_;
+};
+
+}
@@ -0,0 +1,71 @@
+// Copyright 2024 Blaise Tine
+//
+// Licensed under the Apache License;
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <iostream>
+#include <assert.h>
+#include <util.h>
+#include "types.h"
+#include "debug.h"
+#include "gshare.h"
+
+using namespace tinyrv;
+
+GShare::GShare(uint32_t BTB_size, uint32_t BHR_size)
+  : BTB_(BTB_size, BTB_entry_t{false, 0x0, 0x0})
+  , PHT_((1 << BHR_size), 0x0)
+  , BHR_(0x0)
+  , BTB_mask_(BTB_size - 1)
+  , BHR_mask_((1 << BHR_size) - 1)
+{
+  assert(ispow2(BTB_size));
+}
+
+GShare::~GShare() {
+  //--
+}
+
+uint32_t GShare::predict(uint32_t PC) {
+  uint32_t next_PC = PC + 4;
+  bool predict_taken = (PHT_[((PC >> 2) ^ BHR_) & BHR_mask_] >= 2);
+  if (predict_taken) {
+    auto& entry = BTB_[(PC >> 2) & BTB_mask_];
+    if (entry.valid && entry.tag == (PC >> 2)) {
+      next_PC = entry.target;
+    }
+  }
+
+  DT(3, "*** GShare: predict PC=0x" << std::hex << PC << ", next_PC=0x" << next_PC << std::dec
+        << ", predict_taken=" << predict_taken);
+  return next_PC;
+}
+
+void GShare::update(uint32_t PC, uint32_t next_PC, bool taken) {
+  DT(3, "*** GShare: update PC=0x" << std::hex << PC << ", next_PC=0x" << next_PC << std::dec
+        << ", taken=" << taken);
+
+  auto& counter = PHT_[((PC >> 2) ^ BHR_) & BHR_mask_];
+  if (taken) {
+    if (counter < 3)
+      ++counter;
+  } else {
+    if (counter > 0)
+      --counter;
+  }
+
+  if (taken) {
+    auto& entry = BTB_[(PC >> 2) & BTB_mask_];
+    entry = {true, (PC >> 2), next_PC};
+  }
+
+  BHR_ = ((BHR_ << 1) | taken) & BHR_mask_;
+}
@@ -57,6 +57,8 @@ public:
     , func7_(0)
     , alu_op_(AluOp::ADD)
     , exe_flags_(ExeFlags{})
+    , pred_PC_(PC + 4)
+    , next_PC_(PC + 4)
   {}
 
   void setOpcode(Opcode opcode)  {
@@ -103,6 +105,18 @@ public:
     fu_type_ = value;
   }
 
+  void setPredPC(uint32_t value) {
+    pred_PC_ = value;
+  }
+
+  void setNextPC(uint32_t value) {
+    next_PC_ = value;
+  }
+
+  void setFused(Ptr head) {
+    fused_ = head;
+  }
+
   uint64_t getId() const { return uuid_; }
   uint32_t getPC() const { return PC_; }
 
@@ -119,6 +133,12 @@ public:
   ExeFlags getExeFlags() const { return exe_flags_; }
   FUType   getFUType() const { return fu_type_; }
 
+  uint32_t getPredPC() const { return pred_PC_; }   // predicted at fetch
+  uint32_t getNextPC() const { return next_PC_; }   // resolved by the BRU
+
+  // first instruction of a fused pair, executed before this one
+  const Ptr& getFused() const { return fused_; }
+
 private:
 
   uint64_t  uuid_;
@@ -137,6 +157,11 @@ private:
   ExeFlags  exe_flags_;
   FUType    fu_type_;
 
+  uint32_t  pred_PC_;
+  uint32_t  next_PC_;
+
+  Ptr       fused_;
+
   friend std::ostream &operator<<(std::ostream &, const Instr&);
 };
 
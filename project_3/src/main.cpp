@@ -22,24 +22,37 @@
 #include <util.h>
 #include "processor.h"
 #include "mem.h"
+#include "symtab.h"
 #include "core.h"
 
 using namespace tinyrv;
 
 static void show_usage() {
-   std::cout << "Usage: [-g: gshare] [-s: stats] [-h: help] <program>" << std::endl;
+   std::cout << "Usage: [-g: gshare] [-s: stats] [-c: cache parsed image] [-m <file>: write miss-ratio curves] [-h: help] <program>" << std::endl;
 }
 
 bool showStats = false;
+bool gshare = false;
+bool cacheImage = false;
+const char* mrcFile = nullptr;
 const char* program = nullptr;
 
 static void parse_args(int argc, char **argv) {
   int c;
-  while ((c = getopt(argc, argv, "gsh?")) != -1) {
+  while ((c = getopt(argc, argv, "gscm:h?")) != -1) {
     switch (c) {
+    case 'g':
+      gshare = true;
+      break;
     case 's':
       showStats = true;
       break;
+    case 'c':
+      cacheImage = true;
+      break;
+    case 'm':
+      mrcFile = optarg;
+      break;
     case 'h':
     case '?':
       show_usage();
@@ -60,6 +73,13 @@ static void parse_args(int argc, char **argv) {
   }
 }
 
+static bool is_elf_file(const char* filename) {
+  std::ifstream ifs(filename, std::ios::binary);
+  char magic[4] = {0};
+  ifs.read(magic, sizeof(magic));
+  return ifs && magic[0] == 0x7f && magic[1] == 'E' && magic[2] == 'L' && magic[3] == 'F';
+}
+
 int main(int argc, char **argv) {
   int exitcode = -1;
 
@@ -69,15 +89,21 @@ int main(int argc, char **argv) {
     // create memory module
     RAM ram(RAM_PAGE_SIZE);
 
+    // program symbols (ELF only)
+    SymbolTable symbols;
+    uint64_t startup_addr = STARTUP_ADDR;
+
     // load program
     {
       std::string program_ext(fileExtension(program));
       if (program_ext == "bin") {
         ram.loadBinImage(program, STARTUP_ADDR);
       } else if (program_ext == "hex") {
-        ram.loadHexImage(program);
+        ram.loadHexImage(program, cacheImage);
+      } else if (program_ext == "elf" || is_elf_file(program)) {
+        startup_addr = ram.loadElfImage(program, &symbols);
       } else {
-        std::cout << "*** error: only *.bin or *.hex images supported." << std::endl;
+        std::cout << "*** error: only *.bin, *.hex or ELF images supported." << std::endl;
         return -1;
       }
     }
@@ -88,6 +114,20 @@ int main(int argc, char **argv) {
     // attach memory module
     processor.attach_ram(&ram);
 
+    // attach program symbols and entry point
+    processor.attach_symbols(&symbols);
+    processor.set_startup_addr(startup_addr);
+
+    // predict branches
+    if (gshare) {
+      processor.enable_gshare();
+    }
+
+    // record miss-ratio curves
+    if (mrcFile) {
+      processor.set_mrc_file(mrcFile);
+    }
+
     // run simulation
     exitcode = processor.run(true);
     if (exitcode != 0) {
@@ -13,6 +13,7 @@
 
 #include <iostream>
 #include <iomanip>
+#include <algorithm>
 #include <string.h>
 #include <assert.h>
 #include <util.h>
@@ -23,141 +24,431 @@
 
 using namespace tinyrv;
 
+// register moves: ADDI rd, rs, 0 and ADD rd, rs, x0 (or x0, rs),
+// return the source register, else -1
+static int move_source(const Instr& instr) {
+  if (instr.getFused())
+    return -1;
+  auto rs1 = instr.getRs1();
+  auto rs2 = instr.getRs2();
+  switch (instr.getOpcode()) {
+  case Opcode::I:
+    if (instr.getFunc3() == 0 && instr.getImm() == 0 && rs1 != 0)
+      return rs1;
+    break;
+  case Opcode::R:
+    if (instr.getFunc3() == 0 && instr.getFunc7() == 0 && (rs1 == 0) != (rs2 == 0))
+      return (rs1 != 0) ? rs1 : rs2;
+    break;
+  default:
+    break;
+  }
+  return -1;
+}
+
+// zero idioms and constants: XOR/SUB rd, rs, rs, LUI, ADDI rd, x0, imm
+// and ADD rd, x0, x0, return true with their result
+static bool constant_result(const Instr& instr, uint32_t* value) {
+  if (instr.getFused())
+    return false;
+  auto rs1 = instr.getRs1();
+  auto rs2 = instr.getRs2();
+  switch (instr.getOpcode()) {
+  case Opcode::LUI:
+    *value = instr.getImm();
+    return true;
+  case Opcode::I:
+    if (instr.getFunc3() == 0 && rs1 == 0) {
+      *value = instr.getImm();
+      return true;
+    }
+    break;
+  case Opcode::R:
+    if ((instr.getFunc3() == 4 || (instr.getFunc3() == 0 && instr.getFunc7() != 0)) && rs1 == rs2) {
+      *value = 0;
+      return true;
+    }
+    if (instr.getFunc3() == 0 && rs1 == 0 && rs2 == 0) {
+      *value = 0;
+      return true;
+    }
+    break;
+  default:
+    break;
+  }
+  return false;
+}
+
 void Core::issue() {
-  if (issue_queue_->empty())
-    return;
+  // rename up to ISSUE_WIDTH instructions per cycle in program order.
+  // each instruction reads the RAT after the older ones of its group have
+  // updated it, which forwards the group's internal dependencies.
+  for (uint32_t slot = 0; slot < ISSUE_WIDTH; ++slot) {
+    if (issue_queue_->empty()) {
+      // the front-end did not deliver enough instructions
+      ++perf_stats_.frontend_bound;
+      return;
+    }
 
-  auto& is_data = issue_queue_->data();
-  auto instr = is_data.instr;
-  auto exe_flags = instr->getExeFlags();
+    auto& is_group = issue_queue_->data();
+    auto instr = is_group.at(issue_index_).instr;
+    auto exe_flags = instr->getExeFlags();
 
-  // check for structial hazards
-  // TODO:
+    // moves and constant results complete at rename without an RS entry.
+    // a move remaps rd to the physical register of its source, with ROB
+    // renaming it forwards the source value when that is already known.
+    bool has_rd = exe_flags.use_rd && instr->getRd() != 0;
+    int move_reg = -1;
+    bool is_const = false;
+    bool is_move = false;
+    uint32_t const_value = 0;
+    if (MOVE_ELIMINATION && has_rd) {
+      is_const = constant_result(*instr, &const_value);
+      move_reg = is_const ? -1 : move_source(*instr);
+      is_move = (move_reg != -1);
+      if (RENAME_SCHEME != RENAME_PRF && is_move) {
+        if (!RAT_.exists(move_reg)) {
+          const_value = reg_file_[move_reg];
+          is_const = true;
+        } else if (ROB_.ready(RAT_.get(move_reg))) {
+          const_value = ROB_.get_entry(RAT_.get(move_reg)).result;
+          is_const = true;
+        } else {
+          is_move = false;
+        }
+        move_reg = -1;
+      }
+    }
+    bool eliminated = is_const || is_move;
 
-  if(ROB_.full() || RS_.full()) {
-    return; 
-  }
+    // check for structial hazards
+    // TODO:
 
-  uint32_t rs1_data = 0;  // rs1 data obtained from register file or ROB
-  uint32_t rs2_data = 0;  // rs2 data obtained from register file or ROB
-  int rs1_rsid = -1;      // reservation station id for rs1 (-1 indicates data in already available)
-  int rs2_rsid = -1;      // reservation station id for rs2 (-1 indicates data is already available)
+    if(ROB_.full() || (!eliminated && RS_.full())) {
+      ++perf_stats_.backend_bound;
+      return; 
+    }
 
-  auto rs1 = instr->getRs1();
-  auto rs2 = instr->getRs2();
+    // with physical registers, the destination needs a free one
+    if (RENAME_SCHEME == RENAME_PRF && has_rd && move_reg == -1 && PRF_.empty()) {
+      ++perf_stats_.rename_stalls;
+      ++perf_stats_.backend_bound;
+      return;
+    }
 
-  // get rs1 data
-  // check the RAT if value is in the registe file
-  // if not in the register file, check data is in the ROB
-  // else set rs1_rsid to the reservation station id producing the data
-  // remember to first check if the instruction actually uses rs1
-  // HINT: should use RAT, ROB, RST, and reg_file_
-  // TODO:
-  if(exe_flags.use_rs1){
-    if (rs1 != 0){
-      if (RAT_.exists(rs1)){
-        int rs1_rob_idx = RAT_.get(rs1);
-        auto& rob_val = ROB_.get_entry(rs1_rob_idx);
-        if(rob_val.ready){
-          rs1_data = rob_val.result; 
+    // memory instructions also need a load or store queue entry
+    bool is_mem = exe_flags.is_load || exe_flags.is_store;
+    if (is_mem && LSQ_.full(exe_flags.is_store)) {
+      ++perf_stats_.backend_bound;
+      return;
+    }
+
+    uint32_t rs1_data = 0;  // rs1 data obtained from register file or ROB
+    uint32_t rs2_data = 0;  // rs2 data obtained from register file or ROB
+    int rs1_rsid = -1;      // reservation station id for rs1 (-1 indicates data in already available)
+    int rs2_rsid = -1;      // reservation station id for rs2 (-1 indicates data is already available)
+
+    auto rs1 = instr->getRs1();
+    auto rs2 = instr->getRs2();
+
+    // get rs1 data
+    // check the RAT if value is in the registe file
+    // if not in the register file, check data is in the ROB
+    // else set rs1_rsid to the reservation station id producing the data
+    // remember to first check if the instruction actually uses rs1
+    // HINT: should use RAT, ROB, RST, and reg_file_
+    // TODO:
+    if(exe_flags.use_rs1){
+      if (rs1 != 0){
+        if (RENAME_SCHEME == RENAME_PRF) {
+          // read the physical register, or wait for its producer
+          int preg = RAT_.get(rs1);
+          if (PRF_.ready(preg)) {
+            rs1_data = PRF_.read(preg);
+          } else {
+            rs1_rsid = RST_[preg];
+          }
+        }
+        else if (RAT_.exists(rs1)){
+          int rs1_rob_idx = RAT_.get(rs1);
+          auto& rob_val = ROB_.get_entry(rs1_rob_idx);
+          if(ROB_.ready(rs1_rob_idx)){
+            rs1_data = rob_val.result; 
+          }
+          else{
+            rs1_rsid = RST_[rs1_rob_idx]; 
+          }
         }
         else{
-          rs1_rsid = RST_[rs1_rob_idx]; 
+          rs1_data = reg_file_[rs1]; 
         }
       }
-      else{
-        rs1_data = reg_file_[rs1]; 
-      }
     }
-  }
 
-  // get rs2 data
-  // check the RAT if value is in the registe file
-  // if not in the register file, check data is in the ROB
-  // else set rs1_rsid to the reservation station id producing the data
-  // remember to first check if the instruction actually uses rs2
-  // HINT: should use RAT, ROB, RST, and reg_file_
-  // TODO:
-  if(exe_flags.use_rs2){
-    if (rs2 != 0){
-      if (RAT_.exists(rs2)){
-        int rs2_rob_idx = RAT_.get(rs2);
-        auto& rob_val = ROB_.get_entry(rs2_rob_idx);
-        if(rob_val.ready){
-          rs2_data = rob_val.result; 
+    // get rs2 data
+    // check the RAT if value is in the registe file
+    // if not in the register file, check data is in the ROB
+    // else set rs1_rsid to the reservation station id producing the data
+    // remember to first check if the instruction actually uses rs2
+    // HINT: should use RAT, ROB, RST, and reg_file_
+    // TODO:
+    if(exe_flags.use_rs2){
+      if (rs2 != 0){
+        if (RENAME_SCHEME == RENAME_PRF) {
+          // read the physical register, or wait for its producer
+          int preg = RAT_.get(rs2);
+          if (PRF_.ready(preg)) {
+            rs2_data = PRF_.read(preg);
+          } else {
+            rs2_rsid = RST_[preg];
+          }
+        }
+        else if (RAT_.exists(rs2)){
+          int rs2_rob_idx = RAT_.get(rs2);
+          auto& rob_val = ROB_.get_entry(rs2_rob_idx);
+          if(ROB_.ready(rs2_rob_idx)){
+            rs2_data = rob_val.result; 
+          }
+          else{
+            rs2_rsid = RST_[rs2_rob_idx]; 
+          }
         }
         else{
-          rs2_rsid = RST_[rs2_rob_idx]; 
+          rs2_data = reg_file_[rs2]; 
         }
       }
-      else{
-        rs2_data = reg_file_[rs2]; 
+    }
+
+    // allocat new ROB entry and obtain its index
+    // TODO:
+    int rob_idx = ROB_.allocate(instr); 
+    if (exe_flags.is_store) {
+      LSQ_.allocate(*instr, rob_idx);
+      store_sets_.issue_store(instr->getPC(), instr->getId());
+    } else if (exe_flags.is_load) {
+      uint64_t wait = LoadStoreQueue::NO_STORE;
+      if (MEM_DEP_POLICY == MEM_DEP_STORE_SET) {
+        wait = store_sets_.predict(instr->getPC());
       }
+      LSQ_.allocate(*instr, rob_idx, wait);
     }
-  }
 
-  // allocat new ROB entry and obtain its index
-  // TODO:
-  int rob_idx = ROB_.allocate(instr); 
+    // update the RAT mapping if this instruction write to the register file
+    // TODO:
+    int rename_idx = rob_idx;
+    if (RENAME_SCHEME == RENAME_PRF && has_rd) {
+      // map rd to a new physical register, the old one is freed at commit
+      auto& rob_entry = ROB_.get_entry(rob_idx);
+      if (move_reg != -1) {
+        rename_idx = RAT_.get(move_reg);
+        PRF_.share(rename_idx);
+      } else {
+        rename_idx = PRF_.allocate();
+      }
+      rob_entry.pdst = rename_idx;
+      rob_entry.old_pdst = RAT_.get(instr->getRd());
+    }
+    if(exe_flags.use_rd && instr->getRd() != 0){
+      RAT_.set(instr->getRd(), rename_idx); 
+    }
 
-  // update the RAT mapping if this instruction write to the register file
-  // TODO:
-  if(exe_flags.use_rd && instr->getRd() != 0){
-    RAT_.set(instr->getRd(), rob_idx); 
-  }
+    if (eliminated) {
+      // complete the ROB entry now, consumers read the result at rename
+      // or keep waiting on the producer of a shared physical register
+      if (is_move) {
+        ++perf_stats_.eliminated_moves;
+      } else {
+        ++perf_stats_.eliminated_consts;
+      }
+      if (move_reg != -1) {
+        ROB_.complete(rob_idx);
+      } else {
+        if (RENAME_SCHEME == RENAME_PRF) {
+          PRF_.write(rename_idx, const_value);
+          ROB_.complete(rob_idx);
+        } else {
+          ROB_.update({const_value, rob_idx, -1});
+        }
+      }
+      DT(2, "Issue: eliminated " << *instr);
+    } else {
+      // issue the instruction to free reservation station
+      // TODO:
+      int rs_idx = RS_.issue(rob_idx, rs1_rsid, rs2_rsid, rs1_data, rs2_data, instr);
+
+      // update RST mapping
+      // TODO:
+      if(exe_flags.use_rd && instr->getRd() != 0){
+        RST_[rename_idx] = rs_idx;  
+      }
 
-  // issue the instruction to free reservation station
-  // TODO:
-  int rs_idx = RS_.issue(rob_idx, rs1_rsid, rs2_rsid, rs1_data, rs2_data, instr);
+      DT(2, "Issue: " << *instr);
+    }
 
-  // update RST mapping
-  // TODO:
-  if(exe_flags.use_rd && instr->getRd() != 0){
-    RST_[rob_idx] = rs_idx;  
+    // pop the issue queue once the whole group has issued
+    if (++issue_index_ == is_group.size()) {
+      issue_queue_->pop();
+      issue_index_ = 0;
+    }
   }
-
-  DT(2, "Issue: " << *instr);
-
-  // pop issue queue
-  issue_queue_->pop();
 }
 
 void Core::execute() {
+  // cancel the instructions that were dispatched last cycle on the wakeup
+  // of a load that had not returned yet, they wait for its result again.
+  for (auto& replay : replays_) {
+    FUs_.at(replay.fu_index)->cancel(RS_.rob_index(replay.rs_index));
+    RS_.replay(replay.rs_index);
+    ++perf_stats_.replays;
+    DT(2, "Replay: " << *RS_.get_entry(replay.rs_index).instr);
+  }
+  replays_.clear();
+
   // execute functional units
   for (auto fu : FUs_) {
     fu->execute();
   }
 
-  // find the next functional units that is done executing
-  // and push its output result to the common data bus
-  // then clear the functional unit.
-  // The CDB can only serve one functional unit per cycle
+  // find the functional units that are done executing
+  // and push their output results to the common data buses
+  // then clear the functional units.
+  // The CDB can serve NUM_CDBS functional units per cycle,
+  // CDB_ARBITRATION selects which ones, the others retry next cycle.
   // HINT: should use CDB_ and FUs_
-  for (auto fu : FUs_) {
-    // TODO:
-    if(fu->done()){
-        auto output = fu->get_output(); 
-        fu->clear(); 
-        CDB_.push(output.result, output.rob_index, output.rs_index); 
-        break; 
+  // a unit with several pipes can return one result per pipe.
+  std::vector<int> requests;
+  for (int i = 0; i < (int)FUs_.size(); ++i) {
+    int f = (CDB_ARBITRATION == CDB_ARB_ROUND_ROBIN) ? ((cdb_grant_ + i) % FUs_.size()) : i;
+    if (FUs_[f]->done()) {
+      requests.insert(requests.end(), FUs_[f]->ports(), f);
     }
   }
+  if (CDB_ARBITRATION == CDB_ARB_OLDEST) {
+    std::stable_sort(requests.begin(), requests.end(), [&](int a, int b) {
+      return ROB_.age(FUs_[a]->get_output().rob_index) < ROB_.age(FUs_[b]->get_output().rob_index);
+    });
+  }
+  bool stalled[(int)FUType::NONE] = {};
+  for (int f : requests) {
+    auto& fu = FUs_[f];
+    if (!fu->done())
+      continue;
+    if (SPECULATIVE_WAKEUP) {
+      // the consumers take the result from the unit's output,
+      // they can be scheduled in the cycle it becomes available
+      auto output = fu->get_output();
+      RS_.wakeup({output.result, output.rob_index, output.rs_index});
+    }
+    if (CDB_.full()) {
+      stalled[(int)this->unit_type(f)] = true;
+      continue;
+    }
+    auto output = fu->get_output();
+    fu->clear();
+    CDB_.push(output.result, output.rob_index, output.rs_index);
+    ++perf_stats_.cdb_results;
+    cdb_grant_ = (f + 1) % FUs_.size();
+  }
+  bool cdb_stall = false;
+  for (int t = 0; t < (int)FUType::NONE; ++t) {
+    if (stalled[t]) {
+      ++perf_stats_.cdb_fu_stalls[t];
+      cdb_stall = true;
+    }
+  }
+  if (cdb_stall) {
+    ++perf_stats_.cdb_stalls;
+  }
 
   // schedule ready instructions to corresponding functional units
-  // iterate through all reservation stations, check if the entry is valid, but not running yet,
-  // and its operands are ready, and also make sure that is not locked (LSU case).
-  // once a candidate is found, issue the instruction to its corresponding functional unit.
+  // go through the reservation stations whose operands are ready but are not running yet,
+  // in RS_SELECT order, and issue each to its functional unit if that unit is free.
   // HINT: should use RS_ and FUs_
-  for (int rs_index = 0; rs_index < (int)RS_.size(); ++rs_index) {
+  // loads and system instructions have side effects,
+  // on a predicted path they wait for the older branches to resolve.
+  // loads also wait for the older stores they may depend on.
+  uint32_t resolved = this->resolved_count();
+  auto candidates = RS_.ready();
+
+  // the scheduler expects loads to hit: the ALU and branch consumers of a
+  // load that is not back by then are dispatched anyway and replayed.
+  ReservationStation::Mask speculative(RS_.size());
+  if (SPECULATIVE_WAKEUP) {
+    uint64_t now = SimPlatform::instance().cycles();
+    for (auto it = load_wakeups_.begin(); it != load_wakeups_.end();) {
+      if (it->cycle > now) {
+        ++it;
+        continue;
+      }
+      if (RS_.valid().test(it->rs_index)
+       && RS_.running().test(it->rs_index)
+       && RS_.rob_index(it->rs_index) == it->rob_index) {
+        ReservationStation::Mask waiting(RS_.size());
+        RS_.waiting_on(it->rs_index, &waiting);
+        if (waiting.any()) {
+          ++perf_stats_.load_misses;
+        }
+        for (int i = waiting.next(0); i != -1; i = waiting.next(i + 1)) {
+          auto fu_type = RS_.get_entry(i).instr->getFUType();
+          if (fu_type == FUType::ALU || fu_type == FUType::BRU) {
+            speculative.set(i);
+            candidates.set(i);
+          }
+        }
+      }
+      it = load_wakeups_.erase(it);
+    }
+  }
+
+  for (;;) {
+    int rs_index = RS_.select(candidates, RS_SELECT == RS_SELECT_OLDEST);
+    if (rs_index == -1)
+      break;
+    candidates.reset(rs_index);
     auto& entry = RS_.get_entry(rs_index);
+    int rob_index = RS_.rob_index(rs_index);
+    int fu_index = this->free_unit(entry.instr->getFUType());
+    if (fu_index == -1)
+      continue;
+    auto& fu = FUs_[fu_index];
+    if (speculative.test(rs_index)) {
+      // its operand is not there, the unit slot is lost
+      fu->issue(entry.instr, rob_index, rs_index, entry.rs1_data, entry.rs2_data);
+      RS_.dispatch(rs_index);
+      replays_.push_back({rs_index, fu_index});
+      ++perf_stats_.fu_ops[fu_index];
+      continue;
+    }
     // TODO:
-    if(entry.valid && !entry.running && entry.operands_ready() && !RS_.locked(rs_index)){
-      auto& fu = FUs_.at((int)(entry.instr->getFUType())); 
-      if(!fu->busy()){
-          fu->issue(entry.instr, entry.rob_index, rs_index, entry.rs1_data, entry.rs2_data); 
-          entry.running = true; 
+    if((!is_serializing(*entry.instr) || rob_index == ROB_.head_index())
+    && (ROB_.age(rob_index) <= resolved
+     || entry.instr->getFUType() == FUType::ALU
+     || entry.instr->getFUType() == FUType::BRU
+     || entry.instr->getExeFlags().is_store)){
+      if (entry.instr->getExeFlags().is_load) {
+        // the load address is rs1 + imm
+        uint64_t addr = entry.rs1_data + entry.instr->getImm();
+        uint32_t size = 1 << (entry.instr->getFunc3() & 0x3);
+        if (LSQ_.disambiguate(rob_index, addr, size) == LoadStoreQueue::LOAD_WAIT) {
+          ++LSQ_.perf_stats().blocked;
+          continue;
+        }
+      }
+      fu->issue(entry.instr, rob_index, rs_index, entry.rs1_data, entry.rs2_data); 
+      RS_.dispatch(rs_index); 
+      ++perf_stats_.fu_ops[fu_index];
+      if (SPECULATIVE_WAKEUP && entry.instr->getExeFlags().is_load) {
+        uint32_t hit_latency = DCACHE_ENABLED ? DCACHE_HIT_LATENCY : LSU_LATENCY;
+        load_wakeups_.push_back({SimPlatform::instance().cycles() + hit_latency, rs_index, rob_index});
+        ++perf_stats_.load_wakeups;
       }
-        
+    }
+  }
+
+  // track the units with operations in flight
+  for (uint32_t f = 0; f < FUs_.size(); ++f) {
+    if (FUs_[f]->inflight() != 0) {
+      ++perf_stats_.fu_busy[f];
     }
   }
 }
@@ -167,23 +458,32 @@ void Core::writeback() {
   if (CDB_.empty())
     return;
 
-  auto& cdb_data = CDB_.data();
+  for (uint32_t i = 0; i < CDB_.size(); ++i) {
+    auto& cdb_data = CDB_.data(i);
 
-  // update all reservation stations waiting for operands
-  // HINT: use RS::entry_t::update_operands()
-  for (int rs_index = 0; rs_index < (int)RS_.size(); ++rs_index) {
+    // update the reservation stations waiting for this result
+    // HINT: use RS::entry_t::update_operands()
     // TODO:
-    RS_.get_entry(rs_index).update_operands(cdb_data); 
-  }
+    RS_.wakeup(cdb_data); 
 
-  // free the RS entry associated with this CDB response
-  // so that it can be used by other instructions
-  // TODO:
-  RS_.release(cdb_data.rs_index); 
+    // free the RS entry associated with this CDB response
+    // so that it can be used by other instructions
+    // TODO:
+    RS_.release(cdb_data.rs_index); 
 
-  // update ROB
-  // TODO:
-  ROB_.update(cdb_data); 
+    // update ROB
+    // TODO:
+    if (RENAME_SCHEME == RENAME_PRF) {
+      // the result is written once, to its physical register
+      int pdst = ROB_.get_entry(cdb_data.rob_index).pdst;
+      if (pdst != -1) {
+        PRF_.write(pdst, cdb_data.result);
+      }
+      ROB_.complete(cdb_data.rob_index);
+    } else {
+      ROB_.update(cdb_data); 
+    }
+  }
 
   // clear CDB
   // TODO:
@@ -193,23 +493,47 @@ void Core::writeback() {
 }
 
 void Core::commit() {
-  // commit ROB head entry
-  if (ROB_.empty())
-    return;
-
-  int head_index = ROB_.head_index();
-  auto& rob_head = ROB_.get_entry(head_index);
+  // commit up to COMMIT_WIDTH ready entries from the ROB head in order,
+  // the data cache takes a single store per cycle.
+  uint32_t committed = 0;
+  bool store_done = false;
+  while (committed < COMMIT_WIDTH && !ROB_.empty() && !exited_) {
+    int head_index = ROB_.head_index();
+    auto& rob_head = ROB_.get_entry(head_index);
+
+    // check if the head entry is ready to commit
+    if (!ROB_.ready(head_index))
+      break;
 
-  // check if the head entry is ready to commit
-  if (rob_head.ready) {
     auto instr = rob_head.instr;
     auto exe_flags = instr->getExeFlags();
 
+    // stores write memory when they commit
+    if (exe_flags.is_store) {
+      if (store_done)
+        break;
+      auto& store = LSQ_.store_head();
+      if (!lsu_->store(store.addr, store.data, store.size))
+        break;
+      store_done = true;
+    }
+    if (exe_flags.is_load || exe_flags.is_store) {
+      LSQ_.commit(exe_flags.is_store);
+    }
+
     // If this instruction writes to the register file,
     // (1) update the register file
     // (2) clear the RAT if still pointing to this ROB head
     // TODO:
-    if(exe_flags.use_rd && instr->getRd() != 0){
+    if (RENAME_SCHEME == RENAME_PRF) {
+      // the result is already in the physical register file,
+      // commit its mapping and free the previous one
+      if (rob_head.pdst != -1) {
+        arch_RAT_.set(instr->getRd(), rob_head.pdst);
+        PRF_.release(rob_head.old_pdst);
+      }
+    }
+    else if(exe_flags.use_rd && instr->getRd() != 0){
         reg_file_[instr->getRd()] = rob_head.result; 
         if(RAT_.get(instr->getRd()) == head_index){
             RAT_.clear(instr->getRd()); 
@@ -220,16 +544,44 @@ void Core::commit() {
     // TODO:
     ROB_.pop(); 
 
-    DT(2, "Commit: " << *instr);
+    DT(2, "Commit: " << *instr << this->symbol_name(instr->getPC()));
+
+    // train the branch predictor with the resolved branch
+    if (instr->getBrOp() != BrOp::NONE) {
+      ++perf_stats_.branches;
+      if (bpred_) {
+        auto next_PC = instr->getNextPC();
+        if (next_PC != instr->getPredPC()) {
+          ++perf_stats_.mispredicts;
+        }
+        bpred_->update(instr->getPC(), next_PC, next_PC != instr->getPC() + 4);
+      }
+    }
+
+    // a fused pair retires both of its instructions
+    uint32_t count = 1;
+    if (instr->getFused()) {
+      ++perf_stats_.fused;
+      count = 2;
+    }
+
+    if (symbols_) {
+      int symbol = symbols_->lookup(instr->getPC());
+      if (symbol >= 0) {
+        symbol_instrs_[symbol] += count;
+      }
+    }
 
+    perf_stats_.instrs += count;
     assert(perf_stats_.instrs <= fetched_instrs_);
-    ++perf_stats_.instrs;
+    ++committed;
 
     // handle program termination
     if (exe_flags.is_exit) {
       exited_ = true;
     }
   }
+  ++perf_stats_.commits[committed];
 
   ROB_.dump();
 }
\ No newline at end of file
@@ -0,0 +1,233 @@
+// Copyright 2024 Blaise Tine
+//
+// Licensed under the Apache License;
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <assert.h>
+#include <util.h>
+#include <simobject.h>
+#include "types.h"
+#include "debug.h"
+#include "prefetcher.h"
+
+using namespace tinyrv;
+
+Prefetcher::Prefetcher(const Config& config)
+  : config_(config)
+  , line_bits_(log2ceil(config.line_size))
+  , buffer_(config.buffer_size)
+  , strides_(config.table_size)
+  , streams_(config.streams)
+{
+  assert(ispow2(config.line_size));
+  assert(config.buffer_size != 0);
+  candidates_.reserve(config.degree);
+  this->reset();
+}
+
+Prefetcher::~Prefetcher() {
+  //--
+}
+
+void Prefetcher::reset() {
+  for (auto& entry : buffer_) {
+    entry = {false, false, 0, 0, 0, -1};
+  }
+  for (auto& entry : strides_) {
+    entry = {0, 0, 0, 0};
+  }
+  for (auto& stream : streams_) {
+    stream = {false, 0, 0, 0};
+  }
+  candidates_.clear();
+  clock_ = 0;
+  perf_stats_ = PerfStats();
+}
+
+void Prefetcher::add_candidate(uint64_t line) {
+  if (candidates_.size() < config_.degree
+   && std::find(candidates_.begin(), candidates_.end(), line) == candidates_.end()) {
+    candidates_.push_back(line);
+  }
+}
+
+uint32_t Prefetcher::train(uint32_t PC, uint64_t addr, bool miss) {
+  uint64_t line = addr >> line_bits_;
+  candidates_.clear();
+  ++clock_;
+
+  if (miss) {
+    ++perf_stats_.misses;
+  }
+
+  switch (config_.mode) {
+  case PREFETCH_NEXT_LINE: {
+    if (miss) {
+      for (uint32_t i = 1; i <= config_.degree; ++i) {
+        this->add_candidate(line + i);
+      }
+    }
+  } break;
+  case PREFETCH_STRIDE: {
+    auto& entry = strides_.at((PC >> 2) % config_.table_size);
+    if (entry.PC != PC) {
+      entry = {PC, addr, 0, 0};
+      break;
+    }
+    int64_t delta = int64_t(addr - entry.last);
+    if (delta == entry.stride) {
+      entry.confidence = std::min<uint32_t>(entry.confidence + 1, 3);
+    } else if (entry.confidence != 0) {
+      --entry.confidence;
+    } else {
+      entry.stride = delta;
+    }
+    entry.last = addr;
+    if (entry.confidence >= 2 && entry.stride != 0) {
+      // strides shorter than a line advance one line at a time
+      int64_t line_size = config_.line_size;
+      int64_t step = entry.stride;
+      if (step > -line_size && step < line_size) {
+        step = (step > 0) ? line_size : -line_size;
+      }
+      for (uint32_t i = 1; i <= config_.degree; ++i) {
+        this->add_candidate((addr + step * i) >> line_bits_);
+      }
+    }
+  } break;
+  case PREFETCH_STREAM: {
+    // advance the stream that this line continues
+    for (auto& stream : streams_) {
+      if (!stream.valid)
+        continue;
+      if (line == stream.last)
+        return 0;
+      if (line > stream.last && line <= stream.next) {
+        stream.last  = line;
+        stream.stamp = clock_;
+        stream.next  = std::max(stream.next, line + 1);
+        while (stream.next <= line + config_.degree) {
+          this->add_candidate(stream.next++);
+        }
+        return candidates_.size();
+      }
+    }
+    // allocate a new stream on a miss
+    if (miss && !streams_.empty()) {
+      auto victim = streams_.begin();
+      for (auto it = streams_.begin(); it != streams_.end(); ++it) {
+        if (!it->valid) {
+          victim = it;
+          break;
+        }
+        if (it->stamp < victim->stamp) {
+          victim = it;
+        }
+      }
+      *victim = {true, line, line + 1, clock_};
+      while (victim->next <= line + config_.degree) {
+        this->add_candidate(victim->next++);
+      }
+    }
+  } break;
+  default:
+    break;
+  }
+
+  return candidates_.size();
+}
+
+int Prefetcher::lookup(uint64_t line) const {
+  for (int i = 0; i < (int)buffer_.size(); ++i) {
+    auto& entry = buffer_[i];
+    if (entry.valid && !entry.used && entry.line == line)
+      return i;
+  }
+  return -1;
+}
+
+int Prefetcher::allocate(uint64_t line, uint64_t ready) {
+  // use a free entry, else replace the oldest filled one
+  int victim = -1;
+  for (int i = 0; i < (int)buffer_.size(); ++i) {
+    auto& entry = buffer_[i];
+    if (!entry.valid) {
+      victim = i;
+      break;
+    }
+    if (entry.ready != PENDING
+     && (victim == -1 || entry.stamp < buffer_[victim].stamp)) {
+      victim = i;
+    }
+  }
+  if (victim == -1)
+    return -1;
+
+  auto& entry = buffer_[victim];
+  if (entry.valid) {
+    ++perf_stats_.unused;
+  }
+  entry = {true, false, line, ready, clock_, -1};
+  ++perf_stats_.issued;
+
+  DT(3, "Prefetch: line=0x" << std::hex << line << std::dec << ", entry=" << victim);
+
+  return victim;
+}
+
+uint64_t Prefetcher::consume(int index, int mshr) {
+  auto& entry = buffer_.at(index);
+  assert(entry.valid && !entry.used);
+  ++perf_stats_.useful;
+  if (entry.ready > SimPlatform::instance().cycles()) {
+    ++perf_stats_.late;
+  }
+  if (entry.ready == PENDING) {
+    entry.used = true;
+    entry.mshr = mshr;
+  } else {
+    entry.valid = false;
+  }
+  return entry.ready;
+}
+
+int Prefetcher::fill(int index) {
+  auto& entry = buffer_.at(index);
+  assert(entry.valid && entry.ready == PENDING);
+  entry.ready = SimPlatform::instance().cycles();
+  if (!entry.used)
+    return -1;
+  entry.valid = false;
+  return entry.mshr;
+}
+
+void Prefetcher::showStats() const {
+  uint64_t demand = perf_stats_.useful + perf_stats_.misses;
+  std::cout << std::dec << "PERF: prefetcher: issued=" << perf_stats_.issued
+            << ", useful=" << perf_stats_.useful
+            << ", late=" << perf_stats_.late
+            << ", unused=" << perf_stats_.unused
+            << std::fixed << std::setprecision(2);
+  if (demand != 0) {
+    std::cout << ", coverage=" << (100.0 * perf_stats_.useful / demand) << "%";
+  }
+  if (perf_stats_.issued != 0) {
+    std::cout << ", accuracy=" << (100.0 * perf_stats_.useful / perf_stats_.issued) << "%";
+  }
+  if (perf_stats_.useful != 0) {
+    std::cout << ", timeliness=" << (100.0 * (perf_stats_.useful - perf_stats_.late) / perf_stats_.useful) << "%";
+  }
+  std::cout.unsetf(std::ios::floatfield);
+  std::cout << std::endl;
+}
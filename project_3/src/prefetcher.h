@@ -0,0 +1,133 @@
+// Copyright 2024 Blaise Tine
+//
+// Licensed under the Apache License;
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <vector>
+#include "types.h"
+
+namespace tinyrv {
+
+// Data prefetcher with a small fully-associative prefetch buffer.
+// The LSU trains it with demand load addresses and issues the candidate lines
+// it returns, demand misses that find their line in the buffer are served
+// from it instead of memory. Like the caches, only line addresses are tracked.
+class Prefetcher {
+public:
+  struct Config {
+    uint32_t mode;          // PREFETCH_*
+    uint32_t line_size;     // line size in bytes
+    uint32_t degree;        // lines prefetched ahead
+    uint32_t buffer_size;   // prefetch buffer entries
+    uint32_t table_size;    // stride table entries
+    uint32_t streams;       // stream trackers
+  };
+
+  struct PerfStats {
+    uint64_t issued;
+    uint64_t useful;    // demand misses served by the buffer
+    uint64_t late;      // useful prefetches still in flight
+    uint64_t unused;    // evicted before use
+    uint64_t misses;    // demand misses not covered
+
+    PerfStats()
+      : issued(0)
+      , useful(0)
+      , late(0)
+      , unused(0)
+      , misses(0)
+    {}
+  };
+
+  // fill cycle of an entry waiting for memory
+  static constexpr uint64_t PENDING = uint64_t(-1);
+
+  Prefetcher(const Config& config);
+
+  ~Prefetcher();
+
+  void reset();
+
+  bool enabled() const {
+    return config_.mode != PREFETCH_NONE;
+  }
+
+  // train with a demand load, return the number of candidate lines.
+  // miss tells whether the load missed both the cache and the buffer.
+  uint32_t train(uint32_t PC, uint64_t addr, bool miss);
+
+  uint64_t candidate(uint32_t index) const {
+    return candidates_.at(index);
+  }
+
+  // buffer entry holding the given line, or -1
+  int lookup(uint64_t line) const;
+
+  bool pending(int index) const {
+    return buffer_.at(index).ready == PENDING;
+  }
+
+  // allocate a buffer entry for a prefetch, return -1 when all are in flight
+  int allocate(uint64_t line, uint64_t ready);
+
+  // consume an entry on a demand miss and return its fill cycle,
+  // an in-flight entry forwards its fill to the demand MSHR.
+  uint64_t consume(int index, int mshr);
+
+  // complete the fill of an entry, return the MSHR waiting for it or -1
+  int fill(int index);
+
+  const PerfStats& perf_stats() const {
+    return perf_stats_;
+  }
+
+  void showStats() const;
+
+private:
+
+  struct entry_t {
+    bool     valid;
+    bool     used;
+    uint64_t line;
+    uint64_t ready;
+    uint64_t stamp;
+    int      mshr;
+  };
+
+  struct stride_t {
+    uint32_t PC;
+    uint64_t last;
+    int64_t  stride;
+    uint32_t confidence;
+  };
+
+  struct stream_t {
+    bool     valid;
+    uint64_t last;    // last demand line
+    uint64_t next;    // next line to prefetch
+    uint64_t stamp;
+  };
+
+  void add_candidate(uint64_t line);
+
+  Config config_;
+  uint32_t line_bits_;
+  std::vector<entry_t>  buffer_;
+  std::vector<stride_t> strides_;
+  std::vector<stream_t> streams_;
+  std::vector<uint64_t> candidates_;
+  uint64_t clock_;
+  PerfStats perf_stats_;
+};
+
+}
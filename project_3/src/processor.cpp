@@ -11,6 +11,7 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <fstream>
 #include "processor.h"
 #include "processor_impl.h"
 
@@ -23,6 +24,13 @@ ProcessorImpl::ProcessorImpl() {
   // create the core
   core_ = Core::Create(0, this);
 
+  // create the memory controller
+  dram_ = DramController::Create();
+
+  // connect the core to memory
+  core_->mem_req_port.bind(&dram_->req_port);
+  dram_->rsp_port.bind(&core_->mem_rsp_port);
+
   this->reset();
 }
 
@@ -33,12 +41,30 @@ ProcessorImpl::~ProcessorImpl() {
 
 void ProcessorImpl::reset() {
   core_->reset();
+  dram_->reset();
 }
 
 void ProcessorImpl::attach_ram(RAM* ram) {
   core_->attach_ram(ram);
 }
 
+void ProcessorImpl::attach_symbols(const SymbolTable* symbols) {
+  core_->attach_symbols(symbols);
+}
+
+void ProcessorImpl::set_startup_addr(uint32_t addr) {
+  core_->set_startup_addr(addr);
+}
+
+void ProcessorImpl::set_mrc_file(const char* filename) {
+  mrc_file_ = filename;
+  core_->enable_stack_dist();
+}
+
+void ProcessorImpl::enable_gshare() {
+  core_->enable_gshare();
+}
+
 int ProcessorImpl::run(bool riscv_test) {
   SimPlatform::instance().reset();
   this->reset();
@@ -50,11 +76,23 @@ int ProcessorImpl::run(bool riscv_test) {
     done = core_->check_exit(&exitcode, riscv_test);
   } while (!done);
 
+  if (!mrc_file_.empty()) {
+    std::ofstream ofs(mrc_file_);
+    if (!ofs) {
+      std::cout << "*** error: cannot write " << mrc_file_ << std::endl;
+    } else {
+      core_->stack_dist()->dump(ofs);
+    }
+  }
+
   return exitcode;
 }
 
 void ProcessorImpl::showStats() {
   core_->showStats();
+  if (DRAM_ENABLED) {
+    dram_->showStats();
+  }
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -71,6 +109,22 @@ void Processor::attach_ram(RAM* mem) {
   impl_->attach_ram(mem);
 }
 
+void Processor::attach_symbols(const SymbolTable* symbols) {
+  impl_->attach_symbols(symbols);
+}
+
+void Processor::set_startup_addr(uint32_t addr) {
+  impl_->set_startup_addr(addr);
+}
+
+void Processor::set_mrc_file(const char* filename) {
+  impl_->set_mrc_file(filename);
+}
+
+void Processor::enable_gshare() {
+  impl_->enable_gshare();
+}
+
 int Processor::run(bool riscv_test) {
   return impl_->run(riscv_test);
 }
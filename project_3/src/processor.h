@@ -18,6 +18,7 @@
 namespace tinyrv {
 
 class RAM;
+class SymbolTable;
 class ProcessorImpl;
 
 class Processor {
@@ -27,6 +28,16 @@ public:
 
   void attach_ram(RAM* mem);
 
+  void attach_symbols(const SymbolTable* symbols);
+
+  void set_startup_addr(uint32_t addr);
+
+  // write the data cache miss-ratio curves to filename after the run
+  void set_mrc_file(const char* filename);
+
+  // enable the GShare branch predictor
+  void enable_gshare();
+
   int run(bool riscv_test);
 
   void showStats();
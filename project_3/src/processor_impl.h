@@ -14,6 +14,7 @@
 #pragma once
 
 #include "core.h"
+#include "dram.h"
 
 namespace tinyrv {
 
@@ -25,6 +26,14 @@ public:
 
   void attach_ram(RAM* mem);
 
+  void attach_symbols(const SymbolTable* symbols);
+
+  void set_startup_addr(uint32_t addr);
+
+  void set_mrc_file(const char* filename);
+
+  void enable_gshare();
+
   int run(bool riscv_test);
 
   void showStats();
@@ -33,6 +42,8 @@ private:
   void reset();
 
   Core::Ptr core_;
+  DramController::Ptr dram_;
+  std::string mrc_file_;
 };
 
 }
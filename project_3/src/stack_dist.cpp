@@ -0,0 +1,138 @@
+// Copyright 2024 Blaise Tine
+//
+// Licensed under the Apache License;
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <iostream>
+#include <iomanip>
+#include <assert.h>
+#include <util.h>
+#include "types.h"
+#include "debug.h"
+#include "stack_dist.h"
+
+using namespace tinyrv;
+
+uint32_t StackDistance::Fenwick::push() {
+  uint32_t capacity = marks_.size();
+  if (size_ == capacity) {
+    // grow and rebuild the tree from the marks
+    capacity = std::max<uint32_t>(64, 2 * capacity);
+    marks_.resize(capacity, 0);
+    tree_.assign(capacity + 1, 0);
+    for (uint32_t i = 1; i <= capacity; ++i) {
+      tree_[i] += marks_[i - 1];
+      uint32_t parent = i + (i & -i);
+      if (parent <= capacity) {
+        tree_[parent] += tree_[i];
+      }
+    }
+  }
+  return size_++;
+}
+
+void StackDistance::Fenwick::add(uint32_t index, int32_t delta) {
+  marks_[index] += delta;
+  uint32_t capacity = marks_.size();
+  for (uint32_t i = index + 1; i <= capacity; i += (i & -i)) {
+    tree_[i] += delta;
+  }
+}
+
+int32_t StackDistance::Fenwick::prefix(uint32_t index) const {
+  int32_t sum = 0;
+  for (uint32_t i = index; i != 0; i -= (i & -i)) {
+    sum += tree_[i];
+  }
+  return sum;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+StackDistance::StackDistance(uint32_t line_size, uint32_t max_size, uint32_t max_sets)
+  : line_bits_(log2ceil(line_size))
+  , max_lines_(max_size / line_size)
+{
+  assert(ispow2(line_size) && ispow2(max_size) && ispow2(max_sets));
+  assert(max_sets <= max_lines_);
+  levels_.resize(log2ceil(max_sets) + 1);
+  this->reset();
+}
+
+StackDistance::~StackDistance() {
+  //--
+}
+
+void StackDistance::reset() {
+  for (uint32_t k = 0; k < levels_.size(); ++k) {
+    auto& level = levels_[k];
+    level.sets.assign(1u << k, Fenwick());
+    level.histogram.assign((max_lines_ >> k) + 1, 0);
+    level.last.clear();
+    level.cold = 0;
+  }
+  accesses_ = 0;
+}
+
+void StackDistance::access(uint64_t addr) {
+  uint64_t line = addr >> line_bits_;
+  ++accesses_;
+  for (uint32_t k = 0; k < levels_.size(); ++k) {
+    auto& level = levels_[k];
+    auto& set = level.sets[line & ((1u << k) - 1)];
+    uint32_t now = set.push();
+    auto it = level.last.find(line);
+    if (it != level.last.end()) {
+      // distinct lines touched in this set since the previous access
+      uint32_t prev = it->second;
+      uint32_t distance = set.prefix(now) - set.prefix(prev + 1);
+      set.add(prev, -1);
+      uint32_t bucket = std::min<uint32_t>(distance, level.histogram.size() - 1);
+      ++level.histogram[bucket];
+      it->second = now;
+    } else {
+      ++level.cold;
+      level.last.emplace(line, now);
+    }
+    set.add(now, 1);
+  }
+}
+
+double StackDistance::miss_ratio(uint32_t sets, uint32_t ways) const {
+  if (accesses_ == 0)
+    return 0.0;
+  uint32_t k = log2ceil(sets);
+  assert(ispow2(sets) && k < levels_.size());
+  auto& level = levels_[k];
+  assert(ways < level.histogram.size());
+  uint64_t misses = level.cold;
+  for (uint32_t d = ways; d < level.histogram.size(); ++d) {
+    misses += level.histogram[d];
+  }
+  return double(misses) / accesses_;
+}
+
+void StackDistance::dump(std::ostream& os) const {
+  uint32_t line_size = 1u << line_bits_;
+  uint32_t max_sets = 1u << (levels_.size() - 1);
+  os << "size,sets,ways,miss_ratio" << std::endl;
+  os << std::fixed << std::setprecision(6);
+  for (uint32_t lines = 1; lines <= max_lines_; lines *= 2) {
+    for (uint32_t ways = 1; ways <= lines; ways *= 2) {
+      uint32_t sets = lines / ways;
+      if (sets > max_sets)
+        continue;
+      os << (lines * line_size) << "," << sets << "," << ways << ","
+         << this->miss_ratio(sets, ways) << std::endl;
+    }
+  }
+  os.unsetf(std::ios::floatfield);
+}
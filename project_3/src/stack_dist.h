@@ -0,0 +1,84 @@
+// Copyright 2024 Blaise Tine
+//
+// Licensed under the Apache License;
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+#include <iostream>
+#include "types.h"
+
+namespace tinyrv {
+
+// Single-pass LRU miss-ratio analyzer (Mattson stack distances).
+// For every power-of-two set count up to max_sets, each access measures the
+// number of distinct lines touched in its set since the previous access to
+// the same line, using a Fenwick tree over per-set access times. An LRU cache
+// with that many sets and W ways misses exactly when this distance is >= W,
+// so one pass over the address stream yields every cache geometry at once.
+class StackDistance {
+public:
+  StackDistance(uint32_t line_size, uint32_t max_size, uint32_t max_sets);
+
+  ~StackDistance();
+
+  void reset();
+
+  // record an access to addr
+  void access(uint64_t addr);
+
+  uint64_t accesses() const {
+    return accesses_;
+  }
+
+  // miss ratio of an LRU cache with the given geometry
+  double miss_ratio(uint32_t sets, uint32_t ways) const;
+
+  // write the miss-ratio curves as csv: size,sets,ways,miss_ratio
+  void dump(std::ostream& os) const;
+
+private:
+
+  // Fenwick tree over 0/1 marks, grown by doubling
+  class Fenwick {
+  public:
+    Fenwick() : size_(0) {}
+
+    // append a zero mark and return its index
+    uint32_t push();
+
+    void add(uint32_t index, int32_t delta);
+
+    // sum of the marks in [0, index)
+    int32_t prefix(uint32_t index) const;
+
+  private:
+    std::vector<int32_t> tree_;
+    std::vector<int8_t>  marks_;
+    uint32_t size_;
+  };
+
+  struct level_t {
+    std::vector<Fenwick>  sets;
+    std::vector<uint64_t> histogram;  // last bucket counts longer distances
+    std::unordered_map<uint64_t, uint32_t> last;  // line -> set-local time
+    uint64_t cold;
+  };
+
+  uint32_t line_bits_;
+  uint32_t max_lines_;
+  std::vector<level_t> levels_;
+  uint64_t accesses_;
+};
+
+}
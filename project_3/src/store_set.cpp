@@ -0,0 +1,101 @@
+// Copyright 2024 Blaise Tine
+//
+// Licensed under the Apache License;
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <iostream>
+#include <algorithm>
+#include <assert.h>
+#include <util.h>
+#include "types.h"
+#include "debug.h"
+#include "store_set.h"
+
+using namespace tinyrv;
+
+StoreSetPredictor::StoreSetPredictor(uint32_t SSIT_size, uint32_t LFST_size)
+  : SSIT_(SSIT_size)
+  , LFST_(LFST_size)
+  , SSIT_mask_(SSIT_size - 1)
+  , LFST_mask_(LFST_size - 1)
+{
+  assert(ispow2(SSIT_size) && ispow2(LFST_size));
+  this->reset();
+}
+
+StoreSetPredictor::~StoreSetPredictor() {
+  //--
+}
+
+void StoreSetPredictor::reset() {
+  for (auto& entry : SSIT_) {
+    entry = {false, 0};
+  }
+  for (auto& entry : LFST_) {
+    entry = {false, 0};
+  }
+}
+
+uint64_t StoreSetPredictor::predict(uint32_t PC) const {
+  auto& ssit = SSIT_[(PC >> 2) & SSIT_mask_];
+  if (!ssit.valid)
+    return NO_STORE;
+  auto& lfst = LFST_[ssit.SSID];
+  return lfst.valid ? lfst.uuid : NO_STORE;
+}
+
+void StoreSetPredictor::issue_store(uint32_t PC, uint64_t uuid) {
+  auto& ssit = SSIT_[(PC >> 2) & SSIT_mask_];
+  if (ssit.valid) {
+    LFST_[ssit.SSID] = {true, uuid};
+  }
+}
+
+void StoreSetPredictor::execute_store(uint32_t PC, uint64_t uuid) {
+  auto& ssit = SSIT_[(PC >> 2) & SSIT_mask_];
+  if (!ssit.valid)
+    return;
+  // a younger store of the set may have replaced it
+  auto& lfst = LFST_[ssit.SSID];
+  if (lfst.valid && lfst.uuid == uuid) {
+    lfst.valid = false;
+  }
+}
+
+void StoreSetPredictor::squash(uint64_t uuid) {
+  for (auto& lfst : LFST_) {
+    if (lfst.valid && lfst.uuid >= uuid) {
+      lfst.valid = false;
+    }
+  }
+}
+
+void StoreSetPredictor::violation(uint32_t load_PC, uint32_t store_PC) {
+  auto& load = SSIT_[(load_PC >> 2) & SSIT_mask_];
+  auto& store = SSIT_[(store_PC >> 2) & SSIT_mask_];
+  if (load.valid && store.valid) {
+    // merge the two sets into the smaller ID
+    uint32_t SSID = std::min(load.SSID, store.SSID);
+    load.SSID = SSID;
+    store.SSID = SSID;
+  } else if (load.valid) {
+    store = {true, load.SSID};
+  } else if (store.valid) {
+    load = {true, store.SSID};
+  } else {
+    uint32_t SSID = (load_PC >> 2) & LFST_mask_;
+    load = {true, SSID};
+    store = {true, SSID};
+  }
+
+  DT(3, "*** StoreSet: load PC=0x" << std::hex << load_PC << ", store PC=0x" << store_PC << std::dec
+        << ", SSID=" << load.SSID);
+}
@@ -0,0 +1,69 @@
+// Copyright 2024 Blaise Tine
+//
+// Licensed under the Apache License;
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <vector>
+#include <util.h>
+
+namespace tinyrv {
+
+// Store-set memory dependence predictor.
+// The store set ID table (SSIT), indexed by PC, groups loads with the
+// stores they have conflicted with. The last fetched store table (LFST)
+// holds the most recent in-flight store of each set, which the loads of
+// that set wait for before they execute.
+class StoreSetPredictor {
+public:
+  static constexpr uint64_t NO_STORE = uint64_t(-1);
+
+  StoreSetPredictor(uint32_t SSIT_size, uint32_t LFST_size);
+
+  ~StoreSetPredictor();
+
+  void reset();
+
+  // store the load at PC should wait for, or NO_STORE
+  uint64_t predict(uint32_t PC) const;
+
+  // an issued store becomes the last store of its set
+  void issue_store(uint32_t PC, uint64_t uuid);
+
+  // an executed store no longer holds back its set
+  void execute_store(uint32_t PC, uint64_t uuid);
+
+  // forget the squashed stores, those from uuid on
+  void squash(uint64_t uuid);
+
+  // a load executed before an older conflicting store, put them in the same set
+  void violation(uint32_t load_PC, uint32_t store_PC);
+
+private:
+
+  struct SSIT_entry_t {
+    bool     valid;
+    uint32_t SSID;
+  };
+
+  struct LFST_entry_t {
+    bool     valid;
+    uint64_t uuid;
+  };
+
+  std::vector<SSIT_entry_t> SSIT_;
+  std::vector<LFST_entry_t> LFST_;
+  uint32_t SSIT_mask_;
+  uint32_t LFST_mask_;
+};
+
+}
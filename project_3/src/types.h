@@ -127,6 +127,7 @@ struct ExeFlags {
   uint32_t is_store    : 1;   // is STORE instruction
   uint32_t is_csr      : 1;   // is CSR instruction
   uint32_t is_exit     : 1;   // is exit instruction
+  uint32_t is_sfence   : 1;   // is SFENCE.VMA instruction
   uint32_t alu_s1_inv  : 1;   // alu source1 is inverted
   uint32_t alu_s1_rs1  : 1;   // alu source1 is rs1
   uint32_t alu_s1_PC   : 1;   // alu source1 is PC
@@ -144,6 +145,7 @@ inline std::ostream &operator<<(std::ostream &os, const ExeFlags& flags) {
     << ", is_store=" << flags.is_store
     << ", is_csr=" << flags.is_csr
     << ", is_exit=" << flags.is_exit
+    << ", is_sfence=" << flags.is_sfence
     << ", alu_s1_inv=" << flags.alu_s1_inv
     << ", alu_s1_rs1=" << flags.alu_s1_rs1
     << ", alu_s1_PC=" << flags.alu_s1_PC
@@ -174,6 +176,30 @@ inline std::ostream &operator<<(std::ostream &os, const FUType& type) {
   return os;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+
+struct MemReq {
+  uint64_t addr;    // block address
+  bool     write;   // write request
+  uint32_t tag;     // requester tag, returned with the response
+};
+
+inline std::ostream &operator<<(std::ostream &os, const MemReq& req) {
+  os << "addr=0x" << std::hex << req.addr << std::dec << ", write=" << req.write << ", tag=0x" << std::hex << req.tag << std::dec;
+  return os;
+}
+
+struct MemRsp {
+  uint32_t tag;     // tag of the matching request
+};
+
+inline std::ostream &operator<<(std::ostream &os, const MemRsp& rsp) {
+  os << "tag=0x" << std::hex << rsp.tag << std::dec;
+  return os;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
 class TicketBarrier  {
 public:
   TicketBarrier () : tick_(0), tock_(0) {}
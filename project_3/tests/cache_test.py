@@ -0,0 +1,14 @@
+#!/usr/bin/env python3
+# Generates the image cache test programs: cache-pass.hex and cache-fail.hex
+# only differ in the value they check, so they have the same size.
+#
+#   $ python3 cache_test.py
+
+from ooo_tests import *
+
+def program(expected):
+  return [ADDI(20, 0, 42)] + finish(20, 21, expected)
+
+if __name__ == '__main__':
+  write_hex('cache-pass.hex', program(42))
+  write_hex('cache-fail.hex', program(43))
@@ -0,0 +1,105 @@
+#!/usr/bin/env python3
+# Generates elf-sum.elf, a linked RV32 executable for the ELF loader.
+# The entry point is not the start of .text, .data is followed in the file by
+# non-zero bytes, and .bss runs past the page of .data into one the loader
+# never writes, so a wrong entry, segment copy or zero-fill fails the test.
+#
+#   $ python3 elf_test.py
+
+import struct
+from ooo_tests import *
+
+TEXT, DATA = BASE, BASE + 0x2000
+VALUES = [3, 1, 4, 1, 5, 9, 2, 6]
+BSS, BSS_SIZE = DATA + 4 * len(VALUES), 0x1100
+
+def program():
+  symbols = {}
+  p = []
+  # the start of .text fails the test, execution must begin at the entry point
+  symbols['bad_entry'] = len(p)
+  p += [ADDI(3, 0, 3), ECALL]
+  # sum(a0 = words, a1 = count): return the sum of the words
+  symbols['sum'] = len(p)
+  p += [ADDI(12, 0, 0)]
+  loop = len(p)
+  p += [LW(13, 10, 0), ADD(12, 12, 13), ADDI(10, 10, 4), ADDI(11, 11, -1)]
+  p += [BNE(11, 0, (loop - len(p)) * 4)]
+  p += [ADDI(10, 12, 0), JALR(0, 1, 0)]
+  # merge(a0 = words, a1 = count): return the OR of the words
+  symbols['merge'] = len(p)
+  p += [ADDI(12, 0, 0)]
+  loop = len(p)
+  p += [LW(13, 10, 0), OR(12, 12, 13), ADDI(10, 10, 4), ADDI(11, 11, -1)]
+  p += [BNE(11, 0, (loop - len(p)) * 4)]
+  p += [ADDI(10, 12, 0), JALR(0, 1, 0)]
+  symbols['_start'] = len(p)
+  p += LI(10, DATA) + [ADDI(11, 0, len(VALUES))]
+  p += [JAL(1, (symbols['sum'] - len(p)) * 4), ADDI(20, 10, 0)]
+  p += LI(10, BSS) + LI(11, BSS_SIZE // 4)
+  p += [JAL(1, (symbols['merge'] - len(p)) * 4), XOR(20, 20, 10)]
+  p += finish(20, 21, sum(VALUES))
+  sizes = {}
+  starts = sorted(symbols.values()) + [len(p)]
+  for name, start in symbols.items():
+    sizes[name] = (starts[starts.index(start) + 1] - start) * 4
+  return p, symbols, sizes
+
+def write_elf(path):
+  words, symbols, sizes = program()
+  text = b''.join(w.to_bytes(4, 'little') for w in words)
+  data = b''.join(v.to_bytes(4, 'little') for v in VALUES)
+
+  # sections: null, .text, .data, .bss, .symtab, .strtab, .shstrtab
+  shstrtab = b'\0.text\0.data\0.bss\0.symtab\0.strtab\0.shstrtab\0'
+  def shname(name):
+    return shstrtab.index(name.encode() + b'\0')
+  strtab = b'\0'
+  syms = [struct.pack('<IIIBBH', 0, 0, 0, 0, 0, 0)]
+  # a mapping symbol, which the profile skips
+  strtab += b'$x\0'
+  syms.append(struct.pack('<IIIBBH', 1, TEXT, 0, 0, 0, 1))
+  for name in ['bad_entry', 'sum', 'merge', '_start']:
+    syms.append(struct.pack('<IIIBBH', len(strtab), TEXT + 4 * symbols[name], sizes[name],
+                            (1 << 4) | 2, 0, 1))   # STB_GLOBAL, STT_FUNC
+    strtab += name.encode() + b'\0'
+  symtab = b''.join(syms)
+
+  # file layout: headers, .text at 0x1000, .data at 0x2000 followed by
+  # non-zero padding, then the symbol tables and section headers
+  out = bytearray(0x1000)
+  out += text
+  out += b'\0' * (0x2000 - len(out))
+  out += data + b'\xff' * 64
+  symtab_off = len(out)
+  out += symtab
+  strtab_off = len(out)
+  out += strtab
+  shstrtab_off = len(out)
+  out += shstrtab
+  out += b'\0' * (-len(out) % 4)
+  shoff = len(out)
+  shdrs = [
+    (0, 0, 0, 0, 0, 0, 0, 0, 0, 0),
+    (shname('.text'), 1, 0x6, TEXT, 0x1000, len(text), 0, 0, 4, 0),             # PROGBITS, AX
+    (shname('.data'), 1, 0x3, DATA, 0x2000, len(data), 0, 0, 4, 0),             # PROGBITS, WA
+    (shname('.bss'), 8, 0x3, BSS, 0x2000 + len(data), BSS_SIZE, 0, 0, 4, 0),    # NOBITS, WA
+    (shname('.symtab'), 2, 0, 0, symtab_off, len(symtab), 5, 2, 4, 16),         # SYMTAB
+    (shname('.strtab'), 3, 0, 0, strtab_off, len(strtab), 0, 0, 1, 0),          # STRTAB
+    (shname('.shstrtab'), 3, 0, 0, shstrtab_off, len(shstrtab), 0, 0, 1, 0),
+  ]
+  for shdr in shdrs:
+    out += struct.pack('<IIIIIIIIII', *shdr)
+
+  # ELF header, then one PT_LOAD per segment
+  ident = b'\x7fELF' + bytes([1, 1, 1]) + b'\0' * 9   # ELFCLASS32, ELFDATA2LSB
+  out[0:52] = ident + struct.pack('<HHIIIIIHHHHHH',
+    2, 243, 1, TEXT + 4 * symbols['_start'], 52, shoff, 0,  # ET_EXEC, EM_RISCV
+    52, 32, 2, 40, len(shdrs), 6)
+  out[52:84] = struct.pack('<IIIIIIII', 1, 0x1000, TEXT, TEXT, len(text), len(text), 5, 0x1000)
+  out[84:116] = struct.pack('<IIIIIIII', 1, 0x2000, DATA, DATA, len(data), len(data) + BSS_SIZE, 6, 0x1000)
+  with open(path, 'wb') as f:
+    f.write(out)
+
+if __name__ == '__main__':
+  write_elf('elf-sum.elf')
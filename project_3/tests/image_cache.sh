@@ -0,0 +1,71 @@
+#!/bin/sh
+# Image cache (-c) test: cache hits, changed or touched programs, and
+# truncated or corrupted sidecars must all run the current program.
+#
+#   $ sh image_cache.sh <tinyrv>
+
+TINYRV=$1
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+prog=$dir/prog.hex
+cache=$prog.imgcache
+
+# run the program with the image cache, expecting pass or fail
+expect() {
+  if "$TINYRV" -c "$prog" > "$dir/out" 2>&1; then
+    result=pass
+  else
+    result=fail
+  fi
+  if [ "$result" != "$1" ]; then
+    cat "$dir/out"
+    echo "Error: $2"
+    exit 1
+  fi
+}
+
+# the sidecar is replaced by a rename whenever the program is parsed again
+inode() {
+  set -- $(ls -i "$cache")
+  echo "$1"
+}
+
+expect_reparsed() {
+  before=$(inode)
+  expect "$1" "$2"
+  [ "$(inode)" != "$before" ] || { echo "Error: $2, the program was not parsed again"; exit 1; }
+}
+
+cp cache-pass.hex "$prog"
+expect pass "first run"
+[ -f "$cache" ] || { echo "Error: no image cache written"; exit 1; }
+
+before=$(inode)
+expect pass "cache hit"
+[ "$(inode)" = "$before" ] || { echo "Error: cache hit, the program was parsed again"; exit 1; }
+
+# same size and modification time, only the content hash differs
+touch -r "$prog" "$dir/stamp"
+cp cache-fail.hex "$prog"
+touch -r "$dir/stamp" "$prog"
+expect_reparsed fail "changed program"
+
+cp cache-pass.hex "$prog"
+expect_reparsed pass "restored program"
+
+sleep 1
+touch "$prog"
+expect_reparsed pass "touched program"
+
+head -c 60 "$cache" > "$dir/truncated"
+mv "$dir/truncated" "$cache"
+expect_reparsed pass "truncated sidecar"
+
+# a first segment size that wraps around when rounded up
+printf '\377\377\377\377\377\377\377\377' | dd of="$cache" bs=1 seek=56 conv=notrunc 2> /dev/null
+expect_reparsed pass "corrupted segment size"
+
+printf 'garbage!' | dd of="$cache" bs=1 seek=0 conv=notrunc 2> /dev/null
+expect_reparsed pass "corrupted header"
+
+echo "PASSED!"
@@ -0,0 +1,261 @@
+#!/usr/bin/env python3
+# Generates the out-of-order feature tests (ooo-*.hex).
+# Like the rv32ui tests, a test passes when it ends with an ECALL and x3 = 1.
+#
+#   $ python3 ooo_tests.py
+
+BASE = 0x80000000
+
+def r(f7, rs2, rs1, f3, rd, op): return (f7 << 25) | (rs2 << 20) | (rs1 << 15) | (f3 << 12) | (rd << 7) | op
+def i(imm, rs1, f3, rd, op): return ((imm & 0xfff) << 20) | (rs1 << 15) | (f3 << 12) | (rd << 7) | op
+def b(imm, rs2, rs1, f3):
+  imm &= 0x1fff
+  return (((imm >> 12) & 1) << 31) | (((imm >> 5) & 0x3f) << 25) | (rs2 << 20) | (rs1 << 15) \
+       | (f3 << 12) | (((imm >> 1) & 0xf) << 8) | (((imm >> 11) & 1) << 7) | 0x63
+def s_(imm, rs2, rs1, f3):
+  imm &= 0xfff
+  return ((imm >> 5) << 25) | (rs2 << 20) | (rs1 << 15) | (f3 << 12) | ((imm & 0x1f) << 7) | 0x23
+def u(imm, rd, op): return ((imm & 0xfffff) << 12) | (rd << 7) | op
+
+ADD  = lambda rd, a, c: r(0, c, a, 0, rd, 0x33)
+SLTU = lambda rd, a, c: r(0, c, a, 3, rd, 0x33)
+XOR  = lambda rd, a, c: r(0, c, a, 4, rd, 0x33)
+OR   = lambda rd, a, c: r(0, c, a, 6, rd, 0x33)
+ADDI = lambda rd, a, imm: i(imm, a, 0, rd, 0x13)
+SLTI = lambda rd, a, imm: i(imm, a, 2, rd, 0x13)
+ANDI = lambda rd, a, imm: i(imm, a, 7, rd, 0x13)
+SLLI = lambda rd, a, sh: i(sh, a, 1, rd, 0x13)
+SRLI = lambda rd, a, sh: i(sh, a, 5, rd, 0x13)
+LH   = lambda rd, a, imm: i(imm, a, 1, rd, 0x03)
+LW   = lambda rd, a, imm: i(imm, a, 2, rd, 0x03)
+LBU  = lambda rd, a, imm: i(imm, a, 4, rd, 0x03)
+SB   = lambda rs2, a, imm: s_(imm, rs2, a, 0)
+SW   = lambda rs2, a, imm: s_(imm, rs2, a, 2)
+BEQ  = lambda a, c, off: b(off, c, a, 0)
+BNE  = lambda a, c, off: b(off, c, a, 1)
+LUI  = lambda rd, imm: u(imm, rd, 0x37)
+AUIPC = lambda rd, imm: u(imm, rd, 0x17)
+JAL  = lambda rd, off: (((off >> 20) & 1) << 31) | (((off >> 1) & 0x3ff) << 21) \
+                     | (((off >> 11) & 1) << 20) | (((off >> 12) & 0xff) << 12) | (rd << 7) | 0x6f
+JALR = lambda rd, a, imm: i(imm, a, 0, rd, 0x67)
+NOP  = ADDI(0, 0, 0)
+ECALL = 0x73
+
+def LI(rd, value):
+  hi = (value + 0x800) >> 12
+  return [LUI(rd, hi & 0xfffff), ADDI(rd, rd, value - (hi << 12))]
+
+def finish(reg, tmp, value):
+  # end the test, passing (x3 = 1) if reg == value
+  return LI(tmp, value) + [BNE(reg, tmp, 12), ADDI(3, 0, 1), ECALL, ADDI(3, 0, 3), ECALL]
+
+def write_hex(path, words):
+  # intel hex, as the rv32ui tests
+  out = []
+  def record(kind, addr, data):
+    data = [len(data), (addr >> 8) & 0xff, addr & 0xff, kind] + list(data)
+    out.append(':' + ''.join('%02X' % x for x in data + [(-sum(data)) & 0xff]))
+  record(4, 0, [(BASE >> 24) & 0xff, (BASE >> 16) & 0xff])
+  data = b''.join(w.to_bytes(4, 'little') for w in words)
+  for offset in range(0, len(data), 16):
+    record(0, (BASE + offset) & 0xffff, data[offset:offset + 16])
+  record(5, 0, BASE.to_bytes(4, 'big'))
+  record(1, 0, [])
+  with open(path, 'w') as f:
+    f.write('\r\n'.join(out) + '\r\n')
+
+# Speculative wakeup: every load of the first pass misses a cold data cache
+# line while its dependent ALU ops were already woken for a hit, so they must
+# replay with the filled value. The second pass hits the same lines.
+def wakeup_test():
+  LINES, DATA = 32, 0x1000
+  values = [0x100 + 7 * k for k in range(LINES)]
+  p = [ADDI(20, 0, 0), ADDI(21, 0, 2)]          # x20: sum, x21: passes
+  outer = len(p)
+  p += LI(10, BASE + DATA) + [ADDI(6, 0, 0), ADDI(7, 0, LINES)]
+  loop = len(p)
+  p += [LW(11, 10, 0),                          # miss on the first pass
+        ADD(12, 11, 11),                        # woken on the hit assumption
+        ADDI(13, 12, 1),
+        ADD(20, 20, 13),
+        ADDI(10, 10, 64),
+        ADDI(6, 6, 1)]
+  p += [BNE(6, 7, (loop - len(p)) * 4)]
+  p += [ADDI(21, 21, -1)]
+  p += [BNE(21, 0, (outer - len(p)) * 4)]
+  p += finish(20, 22, 2 * sum(2 * v + 1 for v in values))
+  assert len(p) * 4 <= DATA
+  p += [0] * (DATA // 4 - len(p))
+  for v in values:
+    p += [v] + [0] * 15                         # one value per 64-byte line
+  return p
+
+# Physical register renaming recovery: random branches mispredict while
+# eliminated moves share registers on both paths, so each recovery rebuilds
+# the reference counts and free list. A leaked register eventually stalls
+# rename for good, a register freed twice gets two writers and corrupts the
+# checksum (or fails the reference count assertions).
+def prf_recovery_test():
+  N, SEED = 4000, 0x1234567
+  p = LI(5, SEED) + [ADDI(6, 0, 0)] + LI(7, N) + [ADDI(20, 0, 0), ADDI(21, 0, 0), ADDI(22, 0, 0)]
+  loop = len(p)
+  p += [SLLI(8, 5, 13), XOR(5, 5, 8),           # xorshift32
+        SRLI(8, 5, 17), XOR(5, 5, 8),
+        SLLI(8, 5, 5), XOR(5, 5, 8),
+        ADDI(9, 5, 0),                          # moves of the new value
+        ADD(10, 0, 9),
+        ANDI(11, 10, 1)]
+  branch = len(p)
+  p += [0]                                      # random, mispredicts half the time
+  p += [ADDI(12, 10, 0),                        # moves on the taken path only
+        ADDI(13, 12, 0),
+        ADD(20, 20, 13),
+        ADDI(21, 21, 1)]
+  p[branch] = BEQ(11, 0, (len(p) - branch) * 4)
+  p += [ADDI(14, 9, 0),                         # moves after the branch
+        ADDI(15, 14, 0),
+        ADDI(14, 15, 0),
+        XOR(22, 22, 14),
+        ADDI(6, 6, 1)]
+  p += [BNE(6, 7, (loop - len(p)) * 4)]
+  state, sum, count, mix = SEED, 0, 0, 0
+  for _ in range(N):
+    state ^= (state << 13) & 0xffffffff
+    state ^= state >> 17
+    state ^= (state << 5) & 0xffffffff
+    if state & 1:
+      sum, count = (sum + state) & 0xffffffff, count + 1
+    mix ^= state
+  p += [ADD(23, 20, 21), XOR(23, 23, 22)]
+  p += finish(23, 24, ((sum + count) & 0xffffffff) ^ mix)
+  return p
+
+# Macro-op fusion: with ISSUE_WIDTH=2, fetch groups start at even words here,
+# so every pair below shares a group and fuses. The checksum depends on the
+# result of each pair, and the random SLTU+BNE branch mispredicts half the
+# time under -g, so recovery must restore the comparison it wrote.
+def fusion_test():
+  N, SEED, CONST = 2000, 0x2468ace, 0x12345678
+  def align(p):
+    # start the next pair or branch target on a fetch group boundary
+    if len(p) % 2:
+      p.append(NOP)
+  def pc(index):
+    return BASE + 4 * index
+  p = LI(5, SEED) + [ADDI(6, 0, 0)] + LI(7, N) + LI(14, 0x8000)
+  p += [ADDI(20, 0, 0), ADDI(21, 0, 0), ADDI(22, 0, 0), ADDI(23, 0, 0)]
+  align(p)
+  loop = len(p)
+  p += [SLLI(8, 5, 13), XOR(5, 5, 8),           # xorshift32
+        SRLI(8, 5, 17), XOR(5, 5, 8),
+        SLLI(8, 5, 5), XOR(5, 5, 8)]
+  p += LI(10, CONST)                            # LUI+ADDI
+  p += [ADD(20, 20, 10)]
+  align(p)
+  p += [SLLI(11, 5, 16), SRLI(11, 11, 16)]      # SLLI+SRLI zero-extension
+  p += [ADD(20, 20, 11)]
+  align(p)
+  auipc_addi = len(p)
+  p += [AUIPC(12, 0), ADDI(12, 12, 12)]         # AUIPC+ADDI
+  p += [ADD(20, 20, 12)]
+  align(p)
+  sltu_bne = len(p)
+  p += [SLTU(13, 11, 14), 0]                    # SLTU+BNE, random
+  p += [ADDI(21, 21, 1)]
+  jal = len(p)
+  p += [0]
+  align(p)
+  taken = len(p)
+  p += [ADDI(21, 21, 0x100)]
+  align(p)
+  join = len(p)
+  p[sltu_bne + 1] = BNE(13, 0, (taken - sltu_bne - 1) * 4)
+  p[jal] = JAL(0, (join - jal) * 4)
+  p += [ADD(20, 20, 13)]                        # the comparison the branch wrote
+  align(p)
+  slti_beq = len(p)
+  p += [SLTI(15, 11, 0x400), 0]                 # SLTI+BEQ, mostly taken
+  p += [ADDI(22, 22, 1)]
+  align(p)
+  p[slti_beq + 1] = BEQ(15, 0, (len(p) - slti_beq - 1) * 4)
+  p += [ADD(22, 22, 15)]
+  align(p)
+  call = len(p)
+  p += [AUIPC(1, 0), 0]                         # AUIPC+JALR far call
+  p += [ADD(20, 20, 1)]                         # the return address
+  p += [ADDI(6, 6, 1)]
+  p += [BNE(6, 7, (loop - len(p)) * 4)]
+  p += [ADD(24, 20, 21), XOR(24, 24, 22), ADD(24, 24, 23)]
+  checksum = len(p)
+  p += [0] * len(finish(24, 25, 0))
+  align(p)
+  function = len(p)
+  p += [ADDI(23, 23, 3), JALR(0, 1, 0)]
+  p[call + 1] = JALR(1, 1, (function - call) * 4)
+
+  state, x20, x21, x22, x23 = SEED, 0, 0, 0, 0
+  for _ in range(N):
+    state ^= (state << 13) & 0xffffffff
+    state ^= state >> 17
+    state ^= (state << 5) & 0xffffffff
+    x11 = state & 0xffff
+    x13 = int(x11 < 0x8000)
+    x15 = int(x11 < 0x400)
+    x20 += CONST + x11 + pc(auipc_addi) + 12 + x13 + pc(call + 2)
+    x21 += 0x100 if x13 else 1
+    x22 += 2 * x15
+    x23 += 3
+  p[checksum:checksum + len(finish(24, 25, 0))] = finish(24, 25, ((((x20 + x21) & 0xffffffff) ^ x22) + x23) & 0xffffffff)
+  return p
+
+# a store whose address resolves late, then a load of the same word with an
+# early address: a speculative load passes the store and reads stale data
+def late_store_loop(p, N, base, data):
+  # the stored values start at 1, the memory word at 0
+  p += [ADDI(6, 0, 1), ADDI(7, 0, N + 1)]
+  loop = len(p)
+  p += [ADD(9, base, 0)] + [ADD(9, 9, 0)] * 8   # slow address chain
+  p += [SW(6, 9, data),
+        LW(15, base, data),                     # must read x6
+        ADD(20, 20, 15),
+        ADDI(6, 6, 1)]
+  p += [BNE(6, 7, (loop - len(p)) * 4)]
+  return sum(range(1, N + 1))
+
+# Load/store queue: loads forwarded from a covering store (whole and shifted),
+# a load partially overlapping an older byte store waits for its commit, and
+# with a speculative policy the late store address loop flushes and replays
+# its violating loads.
+def lsq_test():
+  DATA = 0x1000
+  p = LI(10, BASE + DATA) + LI(5, 0x11223344) + [ADDI(20, 0, 0)]
+  p += [SW(5, 10, 0),
+        LW(11, 10, 0),                          # forwarded 0x11223344
+        LH(12, 10, 2),                          # forwarded 0x1122
+        LBU(13, 10, 1),                         # forwarded 0x33
+        ADDI(6, 0, 0x55),
+        SB(6, 10, 1),
+        LW(14, 10, 0)]                          # partial overlap, 0x11225544
+  p += [XOR(20, 11, 12), ADD(20, 20, 13), XOR(20, 20, 14)]
+  expected = ((0x11223344 ^ 0x1122) + 0x33) ^ 0x11225544
+  expected += late_store_loop(p, 64, 10, 4)
+  p += finish(20, 21, expected & 0xffffffff)
+  assert len(p) * 4 <= DATA
+  return p + [0] * (DATA // 4 - len(p)) + [0] * 2
+
+# Store sets: the late store address loop violates once, which puts the load
+# and the store in one set, then the load waits for the store and forwards.
+def store_set_test():
+  DATA = 0x1000
+  p = LI(10, BASE + DATA) + [ADDI(20, 0, 0)]
+  expected = late_store_loop(p, 200, 10, 0)
+  p += finish(20, 21, expected)
+  assert len(p) * 4 <= DATA
+  return p + [0] * (DATA // 4 - len(p)) + [0]
+
+if __name__ == '__main__':
+  write_hex('ooo-wakeup.hex', wakeup_test())
+  write_hex('ooo-prf-recovery.hex', prf_recovery_test())
+  write_hex('ooo-fusion.hex', fusion_test())
+  write_hex('ooo-lsq.hex', lsq_test())
+  write_hex('ooo-store-set.hex', store_set_test())